@@ -1,7 +1,7 @@
 import { defineConfig } from 'tsup'
 
 export default defineConfig({
-  entry: ['src/frontend/index.ts'],
+  entry: ['src/frontend/index.ts', 'src/frontend/pitch-worklet.ts'],
   format: ['iife'],
   outDir: 'dist',
   clean: false,
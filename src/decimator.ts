@@ -0,0 +1,68 @@
+// Anti-aliased integer-factor decimator for the coarse YIN pass.
+// Blackman windowed-sinc lowpass, only every factor-th output is evaluated (the polyphase
+// form of an FIR decimator), so the cost is taps / factor multiply-adds per input sample.
+
+// Guitar fundamentals stay below 800Hz, a decimated rate around 11kHz keeps them and
+// their first harmonics well inside the passband
+const TARGET_RATE = 11025;
+
+// Keep enough coarse lags for the CMNDF normalisation of the lowest note
+const MIN_COARSE_TAU = 64;
+
+const TAPS_PER_PHASE = 24;
+
+// Decimation factor for a sample rate and lowest detectable frequency, 1 if decimating does not pay off
+export function decimationFactor(sampleRate: number, fMin: number): number {
+   const maxTau = Math.floor(sampleRate / fMin);
+   return Math.max(1, Math.min(Math.floor(sampleRate / TARGET_RATE), Math.floor(maxTau / MIN_COARSE_TAU)));
+}
+
+export class Decimator {
+   readonly factor: number;
+   private readonly taps: Float32Array;
+
+   constructor(factor: number) {
+      if (!Number.isInteger(factor) || factor < 2) {
+         throw new Error(`Decimation factor must be an integer >= 2, got ${factor}`);
+      }
+      this.factor = factor;
+
+      // Cutoff at half the decimated Nyquist frequency, the transition band ends before
+      // anything can alias back below it
+      const length = TAPS_PER_PHASE * factor;
+      const cutoff = 0.25 / factor;
+      const center = (length - 1) / 2;
+      this.taps = new Float32Array(length);
+      let gain = 0;
+      for (let k = 0; k < length; k++) {
+         const x = k - center;
+         const sinc = x === 0 ? 2 * cutoff : Math.sin(2 * Math.PI * cutoff * x) / (Math.PI * x);
+         const w = (2 * Math.PI * k) / (length - 1);
+         const blackman = 0.42 - 0.5 * Math.cos(w) + 0.08 * Math.cos(2 * w);
+         this.taps[k] = sinc * blackman;
+         gain += this.taps[k];
+      }
+      // Unity gain at DC
+      for (let k = 0; k < length; k++) this.taps[k] /= gain;
+   }
+
+   // Number of outputs for inputLength samples, the filter only runs where it fully overlaps the input
+   outputLength(inputLength: number): number {
+      return Math.max(0, Math.floor((inputLength - this.taps.length) / this.factor) + 1);
+   }
+
+   // Decimates input[start, input.length) into output, returns the number of samples written
+   process(input: Float32Array, start: number, output: Float32Array): number {
+      const taps = this.taps;
+      const numTaps = taps.length;
+      const count = Math.min(output.length, this.outputLength(input.length - start));
+      for (let m = 0, offset = start; m < count; m++, offset += this.factor) {
+         let sum = 0;
+         for (let k = 0; k < numTaps; k++) {
+            sum += taps[k] * input[offset + k];
+         }
+         output[m] = sum;
+      }
+      return count;
+   }
+}
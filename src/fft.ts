@@ -0,0 +1,109 @@
+// Iterative radix-2 complex FFT with precomputed twiddles and bit-reversal table.
+// All scratch memory is allocated once in the constructor.
+export class FFT {
+   readonly size: number;
+
+   private readonly cosTable: Float64Array;
+   private readonly sinTable: Float64Array;
+   private readonly reversed: Uint32Array;
+   private readonly re: Float64Array;
+   private readonly im: Float64Array;
+
+   constructor(size: number) {
+      if (size < 2 || (size & (size - 1)) !== 0) {
+         throw new Error(`FFT size must be a power of two, got ${size}`);
+      }
+      this.size = size;
+      this.cosTable = new Float64Array(size / 2);
+      this.sinTable = new Float64Array(size / 2);
+      for (let i = 0; i < size / 2; i++) {
+         this.cosTable[i] = Math.cos((2 * Math.PI * i) / size);
+         this.sinTable[i] = Math.sin((2 * Math.PI * i) / size);
+      }
+
+      const bits = Math.log2(size);
+      this.reversed = new Uint32Array(size);
+      for (let i = 0; i < size; i++) {
+         let r = 0;
+         for (let b = 0; b < bits; b++) {
+            r = (r << 1) | ((i >> b) & 1);
+         }
+         this.reversed[i] = r;
+      }
+
+      this.re = new Float64Array(size);
+      this.im = new Float64Array(size);
+   }
+
+   // In-place transform of (re, im). The inverse transform is unscaled.
+   transform(re: Float64Array, im: Float64Array, inverse = false): void {
+      const n = this.size;
+      const reversed = this.reversed;
+      for (let i = 0; i < n; i++) {
+         const j = reversed[i];
+         if (j > i) {
+            let t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+         }
+      }
+
+      const sign = inverse ? 1 : -1;
+      for (let len = 2; len <= n; len <<= 1) {
+         const half = len >> 1;
+         const step = n / len;
+         for (let start = 0; start < n; start += len) {
+            for (let k = 0; k < half; k++) {
+               const wr = this.cosTable[k * step];
+               const wi = sign * this.sinTable[k * step];
+               const a = start + k;
+               const b = a + half;
+               const tr = re[b] * wr - im[b] * wi;
+               const ti = re[b] * wi + im[b] * wr;
+               re[b] = re[a] - tr;
+               im[b] = im[a] - ti;
+               re[a] += tr;
+               im[a] += ti;
+            }
+         }
+      }
+   }
+
+   // Linear autocorrelation r[lag] = sum_i x[i] * x[i + lag] for lag < maxLag, where x is
+   // input[start, start + length). Requires size >= length + maxLag so the circular correlation does not wrap.
+   autocorrelation(input: Float32Array, output: Float64Array, maxLag: number, start = 0, length = input.length - start): void {
+      const n = length;
+      if (n + maxLag > this.size) {
+         throw new Error(`FFT size ${this.size} too small for ${n} samples and ${maxLag} lags`);
+      }
+
+      const re = this.re;
+      const im = this.im;
+      re.fill(0);
+      im.fill(0);
+      for (let i = 0; i < n; i++) {
+         re[i] = input[start + i];
+      }
+
+      this.transform(re, im);
+      for (let i = 0; i < this.size; i++) {
+         re[i] = re[i] * re[i] + im[i] * im[i];
+         im[i] = 0;
+      }
+      this.transform(re, im, true);
+
+      const scale = 1 / this.size;
+      for (let lag = 0; lag < maxLag; lag++) {
+         output[lag] = re[lag] * scale;
+      }
+   }
+}
+
+export function nextPowerOfTwo(n: number): number {
+   let size = 1;
+   while (size < n) size <<= 1;
+   return size;
+}
@@ -0,0 +1,135 @@
+import { NOTE_NAMES } from "../pitch-detector.js";
+
+// Fixed capacity recording of the detections of a session, one typed array per column. Once
+// full, the oldest detections are overwritten, so long sessions neither grow the heap nor the
+// export. 32768 detections are ~6 minutes at the worklet's ~94 detections per second.
+export const DEBUG_RECORDING_CAPACITY = 32768;
+
+// Note column value for a detection without a note name
+const NO_NOTE = 255;
+
+// Binary session format, little endian. The loader in debug.html reads the same layout.
+//    0  "TDBG"
+//    4  u16 version, u16 reserved
+//    8  u32 detection count
+//   12  u32 metadata length in bytes
+//   16  metadata, UTF-8 JSON, zero padded to a multiple of 8 bytes
+//       f64[count] timestamps (ms since start), f32[count] frequencies, f32[count] cents,
+//       u8[count] note indices into NOTE_NAMES (255: none)
+const MAGIC = "TDBG";
+const VERSION = 1;
+const HEADER_SIZE = 16;
+
+export interface DebugSession {
+   metadata: Record<string, unknown>;
+   timestamps: Float64Array;
+   frequencies: Float32Array;
+   cents: Float32Array;
+   notes: Uint8Array;
+}
+
+export class DebugRecording {
+   readonly capacity: number;
+   readonly timestamps: Float64Array;
+   readonly frequencies: Float32Array;
+   readonly cents: Float32Array;
+   readonly notes: Uint8Array;
+
+   private next = 0;
+   private total = 0;
+
+   constructor(capacity = DEBUG_RECORDING_CAPACITY) {
+      this.capacity = capacity;
+      this.timestamps = new Float64Array(capacity);
+      this.frequencies = new Float32Array(capacity);
+      this.cents = new Float32Array(capacity);
+      this.notes = new Uint8Array(capacity);
+   }
+
+   get length(): number {
+      return Math.min(this.total, this.capacity);
+   }
+
+   // Detections that were overwritten after the recording filled up
+   get overwritten(): number {
+      return this.total - this.length;
+   }
+
+   // Timestamp of the newest detection, 0 when empty
+   get lastTimestamp(): number {
+      return this.total > 0 ? this.timestamps[(this.next + this.capacity - 1) % this.capacity] : 0;
+   }
+
+   push(timestamp: number, frequency: number, note: string, cents: number): void {
+      const index = this.next;
+      this.timestamps[index] = timestamp;
+      this.frequencies[index] = frequency;
+      this.cents[index] = cents;
+      const noteIndex = NOTE_NAMES.indexOf(note);
+      this.notes[index] = noteIndex < 0 ? NO_NOTE : noteIndex;
+      this.next = index + 1 === this.capacity ? 0 : index + 1;
+      this.total++;
+   }
+
+   clear(): void {
+      this.next = 0;
+      this.total = 0;
+   }
+
+   // Encodes the recorded detections, oldest first, and the metadata into the binary session format
+   encode(metadata: Record<string, unknown>): ArrayBuffer {
+      const count = this.length;
+      const json = new TextEncoder().encode(JSON.stringify(metadata));
+      const metadataSize = Math.ceil(json.length / 8) * 8;
+      const columnsOffset = HEADER_SIZE + metadataSize;
+      const buffer = new ArrayBuffer(columnsOffset + count * (8 + 4 + 4 + 1));
+
+      const view = new DataView(buffer);
+      for (let i = 0; i < MAGIC.length; i++) view.setUint8(i, MAGIC.charCodeAt(i));
+      view.setUint16(4, VERSION, true);
+      view.setUint32(8, count, true);
+      view.setUint32(12, json.length, true);
+      new Uint8Array(buffer, HEADER_SIZE, json.length).set(json);
+
+      // The oldest detection sits at next once the recording wrapped around
+      const start = this.total > this.capacity ? this.next : 0;
+      const timestamps = new Float64Array(buffer, columnsOffset, count);
+      const frequencies = new Float32Array(buffer, columnsOffset + count * 8, count);
+      const cents = new Float32Array(buffer, columnsOffset + count * 12, count);
+      const notes = new Uint8Array(buffer, columnsOffset + count * 16, count);
+      const head = count - start;
+      timestamps.set(this.timestamps.subarray(start, count));
+      timestamps.set(this.timestamps.subarray(0, start), head);
+      frequencies.set(this.frequencies.subarray(start, count));
+      frequencies.set(this.frequencies.subarray(0, start), head);
+      cents.set(this.cents.subarray(start, count));
+      cents.set(this.cents.subarray(0, start), head);
+      notes.set(this.notes.subarray(start, count));
+      notes.set(this.notes.subarray(0, start), head);
+      return buffer;
+   }
+}
+
+export function decodeDebugSession(buffer: ArrayBuffer): DebugSession {
+   const view = new DataView(buffer);
+   const magic = String.fromCharCode(view.getUint8(0), view.getUint8(1), view.getUint8(2), view.getUint8(3));
+   if (magic !== MAGIC) {
+      throw new Error("Not a tuner debug session");
+   }
+   const version = view.getUint16(4, true);
+   if (version !== VERSION) {
+      throw new Error(`Unsupported debug session version ${version}`);
+   }
+
+   const count = view.getUint32(8, true);
+   const metadataLength = view.getUint32(12, true);
+   const metadata = JSON.parse(new TextDecoder().decode(new Uint8Array(buffer, HEADER_SIZE, metadataLength)));
+   const columnsOffset = HEADER_SIZE + Math.ceil(metadataLength / 8) * 8;
+   return {
+      metadata,
+      timestamps: new Float64Array(buffer, columnsOffset, count),
+      frequencies: new Float32Array(buffer, columnsOffset + count * 8, count),
+      cents: new Float32Array(buffer, columnsOffset + count * 12, count),
+      notes: new Uint8Array(buffer, columnsOffset + count * 16, count),
+   };
+}
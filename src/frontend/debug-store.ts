@@ -0,0 +1,94 @@
+// Hands debug sessions to debug.html as binary Blobs in IndexedDB, so neither page serialises
+// or parses a multi-megabyte string on its main thread. debug.html opens the same database
+// and channel, keep the names in sync. Where IndexedDB is unavailable (e.g. some private
+// browsing modes) the tuner keeps the session in memory and sends it over the BroadcastChannel
+// when debug.html asks for it, Blobs are passed by reference and not copied.
+
+export const DEBUG_DB_NAME = "tuner-debug";
+export const DEBUG_STORE = "sessions";
+export const DEBUG_CHANNEL = "tuner-debug";
+
+// Saving a session deletes all but the newest MAX_SESSIONS
+const MAX_SESSIONS = 5;
+
+export interface StoredDebugSession {
+   id: string; // Date.now() at export, so ids sort by age
+   session: Blob; // Binary session format, see debug-recording.ts
+   pcm: Blob | null; // Optional raw audio of the session as a WAV file
+}
+
+export type DebugChannelMessage =
+   | { type: "saved"; id: string } // Tuner -> debug page, the session is in IndexedDB
+   | { type: "request"; id: string } // Debug page -> tuner, the session was not in IndexedDB
+   | { type: "session"; session: StoredDebugSession }; // Tuner -> debug page, reply to a request
+
+function promised<T>(request: IDBRequest<T>): Promise<T> {
+   return new Promise((resolve, reject) => {
+      request.onsuccess = () => resolve(request.result);
+      request.onerror = () => reject(request.error);
+   });
+}
+
+function openDatabase(): Promise<IDBDatabase> {
+   const request = indexedDB.open(DEBUG_DB_NAME, 1);
+   request.onupgradeneeded = () => request.result.createObjectStore(DEBUG_STORE, { keyPath: "id" });
+   return promised(request);
+}
+
+// Returns false if the session could not be stored, it is then only available via serveDebugSession
+export async function saveDebugSession(session: StoredDebugSession): Promise<boolean> {
+   let db: IDBDatabase;
+   try {
+      db = await openDatabase();
+   } catch (error) {
+      console.warn("IndexedDB unavailable for debug sessions:", error);
+      return false;
+   }
+
+   try {
+      const store = db.transaction(DEBUG_STORE, "readwrite").objectStore(DEBUG_STORE);
+      await promised(store.put(session));
+      const ids = (await promised(store.getAllKeys())) as string[];
+      for (const id of ids.sort().slice(0, Math.max(0, ids.length - MAX_SESSIONS))) {
+         store.delete(id);
+      }
+      return true;
+   } catch (error) {
+      console.warn("Failed to store debug session:", error);
+      return false;
+   } finally {
+      db.close();
+   }
+}
+
+// Announces a stored session, or answers debug pages asking for a session that could not be stored
+export class DebugSessionServer {
+   private channel: BroadcastChannel | null = null;
+   private unsaved = new Map<string, StoredDebugSession>();
+
+   announce(id: string) {
+      const message: DebugChannelMessage = { type: "saved", id };
+      this.open()?.postMessage(message);
+   }
+
+   // Keeps the newest unsaved session in memory until the page is closed
+   serve(session: StoredDebugSession) {
+      this.unsaved.clear();
+      this.unsaved.set(session.id, session);
+      const message: DebugChannelMessage = { type: "session", session };
+      this.open()?.postMessage(message);
+   }
+
+   private open(): BroadcastChannel | null {
+      if (this.channel || typeof BroadcastChannel === "undefined") return this.channel;
+      this.channel = new BroadcastChannel(DEBUG_CHANNEL);
+      this.channel.onmessage = (event: MessageEvent<DebugChannelMessage>) => {
+         const session = event.data.type === "request" ? this.unsaved.get(event.data.id) : undefined;
+         if (session) {
+            const message: DebugChannelMessage = { type: "session", session };
+            this.channel?.postMessage(message);
+         }
+      };
+      return this.channel;
+   }
+}
@@ -1,4 +1,20 @@
-import { PitchDetector } from "../pitch-detector.js";
+import { CallbackTimer, LatencyHistogram, type LatencySnapshot } from "../latency-stats.js";
+import { OUTLIER_STRATEGIES, type OutlierStrategy } from "../outlier-filter.js";
+import { NOTE_NAMES, PitchDetector, type PitchDetectorStats } from "../pitch-detector.js";
+import { DebugRecording } from "./debug-recording.js";
+import { DebugSessionServer, type StoredDebugSession, saveDebugSession } from "./debug-store.js";
+import {
+   LIVE_FMIN,
+   LIVE_OCTAVE_CORRECTION,
+   LIVE_OUTLIER_FILTER,
+   LIVE_THRESHOLD,
+   SCRIPT_PROCESSOR_BUFFER,
+   WORKLET_HOP_SIZE,
+} from "./live-pipeline.js";
+import { DEFAULT_CAPTURE_SECONDS, encodeWav, MAX_CAPTURE_SECONDS, PcmCapture } from "./pcm-capture.js";
+import { PitchRing, type PitchRecord } from "./pitch-ring.js";
+import { type Accuracy, TunerDisplay } from "./tuner-display.js";
+import type { PitchProcessorOptions, PitchWorkletCommand, PitchWorkletMessage } from "./pitch-worklet.js";
 
 // Live reload for development
 if (window.location.hostname === "localhost" || window.location.hostname === "127.0.0.1") {
@@ -6,15 +22,55 @@ if (window.location.hostname === "localhost" || window.location.hostname === "12
    ws.onmessage = () => location.reload();
 }
 
+type WorkletStats = Extract<PitchWorkletMessage, { type: "stats" }>;
+
+const ACCURACY_STYLES: Record<Accuracy, { noteClass: string; stroke: string }> = {
+   inTune: { noteClass: "text-green-400", stroke: "#22c55e" },
+   close: { noteClass: "text-yellow-400", stroke: "#eab308" },
+   off: { noteClass: "text-red-400", stroke: "#ef4444" },
+};
+
+// Latency counters of a session, shown in the ?stats overlay and included in the debug export
+interface LatencyReport {
+   path: "worklet" | "script-processor" | "analyser";
+   detector: PitchDetectorStats | null;
+   callbackJitter: LatencySnapshot | null; // Audio callbacks only, the analyser path is polled per frame
+   lateCallbacks: number;
+   needleLatency: LatencySnapshot; // End of the analysed audio to needle update, without input latency
+   droppedDetections: number; // Detections the worklet could not hand to the main thread
+   detectionsPerSecond: number;
+}
+
+// Interval of detection rate and overlay updates
+const STATS_REFRESH_MS = 500;
+
+// Raw input of the session, startFrame is the index of the first sample since the tuner started
+interface CapturedPcm {
+   samples: Float32Array;
+   startFrame: number;
+   sampleRate: number;
+}
+
+// How long to wait for the worklet to hand over its capture
+const CAPTURE_TIMEOUT_MS = 2000;
+
+function formatLatency(label: string, snapshot: LatencySnapshot): string {
+   const ms = (value: number) => `${value.toFixed(2)}ms`.padStart(8);
+   return `${label.padEnd(9)} p50 ${ms(snapshot.p50Ms)} p99 ${ms(snapshot.p99Ms)} max ${ms(snapshot.maxMs)}`;
+}
+
 class GuitarTuner {
    private audioContext: AudioContext | null = null;
    private analyser: AnalyserNode | null = null;
    private microphone: MediaStreamAudioSourceNode | null = null;
    private scriptProcessor: ScriptProcessorNode | null = null;
+   private workletNode: AudioWorkletNode | null = null;
+   private pitchRing: PitchRing | null = null; // Shared with the worklet when cross-origin isolated
+   private pitchRecord: PitchRecord = { frequency: 0, cents: 0, noteIndex: 0, time: 0 };
    private isActive = false;
    private animationId: number | null = null;
    private dataArray: Float32Array | null = null;
-   private useRawAudio = true; // Toggle between raw ScriptProcessor and analyser
+   private useRawAudio = true; // Toggle between raw audio (AudioWorklet/ScriptProcessor) and analyser
 
    private pitchDetector?: PitchDetector;
    private a4Frequency: number; // Current A4 reference frequency
@@ -34,14 +90,42 @@ class GuitarTuner {
    private debugBtn = document.getElementById("debug-btn") as HTMLButtonElement | null;
 
    // Debug recording
-   private debugRecording: Array<{
-      timestamp: number;
-      frequency: number;
-      note: string;
-      cents: number;
-   }> = [];
+   private debugRecording = new DebugRecording();
+   private debugSessions = new DebugSessionServer();
    private debugStartTime: number = 0;
-   private lastValidCents: number = 0; // Keep track of last valid cents for needle
+   private display = new TunerDisplay(); // Note, accuracy and needle motion, rendered by renderFrame
+
+   // Latest detection, overwritten by the audio paths and rendered once per animation frame
+   private latest = { pending: false, note: "", frequency: 0, cents: 0, inputTime: 0 };
+   // What the DOM currently shows, so rendering only touches what changed
+   private rendered = { note: "A", frequencyText: "", angle: 0, accuracy: "inTune" as Accuracy };
+   private frameCallback = (time: number) => this.renderFrame(time);
+
+   // Latency instrumentation. With the worklet, detector and callback counters live on the
+   // audio thread and arrive with its stats messages.
+   private needleLatency = new LatencyHistogram();
+   private callbackTimer: CallbackTimer | null = null; // ScriptProcessor path
+   private workletStats: WorkletStats | null = null;
+   private latencyReportAtStop: LatencyReport | null = null;
+   private statsInterval: number | null = null;
+   private rateDetections = 0;
+   private rateTime = 0;
+   private detectionsPerSecond = 0;
+   private statsOverlay = document.getElementById("stats-overlay") as HTMLPreElement | null;
+
+   // Outlier rejection of both detection paths, ?filter=<strategy> for comparing them live
+   private outlierFilter: OutlierStrategy = LIVE_OUTLIER_FILTER;
+
+   // Raw input capture for offline replay, enabled with ?capture or ?capture=<seconds>.
+   // pcmCapture is only used by the ScriptProcessor path. The worklet captures on the audio thread
+   // and hands its ring over on request, workletCapture puts the rings together on the main thread.
+   // captureSpare is the last handed over ring, sent back as the next request's empty one.
+   private captureSeconds = 0;
+   private pcmCapture: PcmCapture | null = null;
+   private workletCapture: PcmCapture | null = null;
+   private captureSpare: Float32Array | null = null;
+   private captureReply: (() => void) | null = null;
+   private capturedAtStop: Promise<CapturedPcm | null> = Promise.resolve(null);
 
    constructor() {
       // Load saved A4 frequency from localStorage, default to 440Hz
@@ -54,6 +138,21 @@ class GuitarTuner {
       this.setupPressAndHold(this.freqUpBtn, 1);
       this.setupPressAndHold(this.freqDownBtn, -1);
 
+      // Latency overlay, e.g. for diagnosing a laggy needle on a specific device
+      const params = new URLSearchParams(window.location.search);
+      if (this.statsOverlay && params.has("stats")) {
+         this.statsOverlay.hidden = false;
+      }
+      const filter = params.get("filter") as OutlierStrategy | null;
+      if (filter && OUTLIER_STRATEGIES.includes(filter)) {
+         this.outlierFilter = filter;
+      }
+      const capture = params.get("capture");
+      if (capture !== null) {
+         const seconds = Number(capture) || DEFAULT_CAPTURE_SECONDS;
+         this.captureSeconds = Math.min(MAX_CAPTURE_SECONDS, Math.max(1, seconds));
+      }
+
       // Set up debug button
       if (this.debugBtn) {
          this.debugBtn.addEventListener("click", () => this.exportDebugData());
@@ -140,6 +239,11 @@ class GuitarTuner {
       // Adjust by 1Hz increments, common range 400-480Hz
       this.a4Frequency = Math.max(400, Math.min(480, this.a4Frequency + direction));
       this.freqDisplay.textContent = `${this.a4Frequency} Hz`;
+      this.pitchDetector?.setA4Frequency(this.a4Frequency);
+      if (this.workletNode) {
+         const command: PitchWorkletCommand = { type: "a4", frequency: this.a4Frequency };
+         this.workletNode.port.postMessage(command);
+      }
       this.saveA4Frequency(); // Persist to localStorage
    }
 
@@ -148,9 +252,12 @@ class GuitarTuner {
       this.pitchDetector = new PitchDetector({
          sampleRate,
          debug: false,
-         threshold: 0.1,
-         fMin: 40.0, // Lower minimum for baritone guitars
+         threshold: LIVE_THRESHOLD,
+         fMin: LIVE_FMIN,
          a4Frequency: this.a4Frequency, // Use current A4 setting
+         outlierFilter: this.outlierFilter,
+         octaveCorrection: LIVE_OCTAVE_CORRECTION,
+         reuseResult: true, // Results are consumed immediately, avoid allocating on the audio callback
       });
 
       console.log(`Pitch detector: ${this.pitchDetector.sampleRate}Hz, ${this.pitchDetector.chunkSize} samples`);
@@ -183,13 +290,54 @@ class GuitarTuner {
          await this.initializePitchDetector(this.audioContext.sampleRate);
 
          this.microphone = this.audioContext.createMediaStreamSource(stream);
-
-         if (this.useRawAudio) {
-            // Use ScriptProcessorNode for raw audio samples
-            this.scriptProcessor = this.audioContext.createScriptProcessor(2048, 1, 1);
+         this.pcmCapture = null;
+         this.workletCapture = null;
+         this.captureSpare = null;
+         this.capturedAtStop = Promise.resolve(null);
+
+         if (this.useRawAudio && this.audioContext.audioWorklet) {
+            // Run pitch detection on the audio rendering thread, only detections are posted back
+            await this.audioContext.audioWorklet.addModule("pitch-worklet.js");
+            this.pitchRing = PitchRing.isSupported() ? PitchRing.create() : null;
+            const processorOptions: PitchProcessorOptions = {
+               threshold: LIVE_THRESHOLD,
+               fMin: LIVE_FMIN,
+               a4Frequency: this.a4Frequency,
+               hopSize: WORKLET_HOP_SIZE,
+               outlierFilter: this.outlierFilter,
+               octaveCorrection: LIVE_OCTAVE_CORRECTION,
+               ring: this.pitchRing?.buffer,
+               captureSeconds: this.captureSeconds,
+            };
+            this.workletNode = new AudioWorkletNode(this.audioContext, "pitch-processor", {
+               numberOfInputs: 1,
+               numberOfOutputs: 1,
+               outputChannelCount: [1],
+               processorOptions,
+            });
+            if (this.captureSeconds > 0) {
+               this.workletCapture = new PcmCapture(Math.round(this.captureSeconds * this.audioContext.sampleRate));
+            }
+            this.workletNode.port.onmessage = (event: MessageEvent<PitchWorkletMessage>) => {
+               this.handleWorkletMessage(event.data);
+            };
+            // Connected to the destination so the node gets pulled, its output is silent
+            this.microphone.connect(this.workletNode);
+            this.workletNode.connect(this.audioContext.destination);
+         } else if (this.useRawAudio) {
+            // ScriptProcessorNode fallback for browsers without AudioWorklet (e.g. insecure contexts)
+            this.scriptProcessor = this.audioContext.createScriptProcessor(SCRIPT_PROCESSOR_BUFFER, 1, 1);
+            const sampleRate = this.audioContext.sampleRate;
+            this.callbackTimer = new CallbackTimer(sampleRate, (SCRIPT_PROCESSOR_BUFFER * 1000) / sampleRate);
+            if (this.captureSeconds > 0) {
+               this.pcmCapture = new PcmCapture(Math.round(this.captureSeconds * sampleRate));
+            }
             this.scriptProcessor.onaudioprocess = (event) => {
+               const inputTime = performance.now();
                const inputBuffer = event.inputBuffer.getChannelData(0);
-               this.processRawAudioChunk(inputBuffer);
+               this.callbackTimer?.tick(inputTime, inputBuffer.length);
+               this.pcmCapture?.push(inputBuffer);
+               this.processRawAudioChunk(inputBuffer, inputTime);
             };
             this.microphone.connect(this.scriptProcessor);
             this.scriptProcessor.connect(this.audioContext.destination);
@@ -200,21 +348,28 @@ class GuitarTuner {
             this.analyser.smoothingTimeConstant = 0.8;
             this.dataArray = new Float32Array(this.analyser.fftSize);
             this.microphone.connect(this.analyser);
+            if (this.captureSeconds > 0) {
+               console.warn("Raw input capture needs the AudioWorklet or ScriptProcessor path");
+            }
          }
 
          this.isActive = true;
          this.debugStartTime = performance.now();
-         this.debugRecording = []; // Reset recording
+         this.debugRecording.clear(); // Reset recording
+         this.needleLatency.reset();
+         this.latencyReportAtStop = null;
+         this.rateDetections = 0;
+         this.rateTime = performance.now();
+         this.detectionsPerSecond = 0;
+         this.statsInterval = window.setInterval(() => this.refreshStats(), STATS_REFRESH_MS);
          this.startBtn.textContent = "STOP";
          this.startBtn.classList.remove("bg-green-600", "hover:bg-green-700");
          this.startBtn.classList.add("bg-red-600", "hover:bg-red-700");
          this.tuningControls.style.display = "none"; // Hide tuning controls when active
          this.clearAutoRepeat(); // Stop any ongoing auto-repeat
 
-         // Start processing audio (only for analyzer method)
-         if (!this.useRawAudio) {
-            this.processAudio();
-         }
+         this.latest.pending = false;
+         this.renderFrame(performance.now());
       } catch (error) {
          console.error("Error accessing microphone:", error);
 
@@ -238,6 +393,14 @@ class GuitarTuner {
 
    stop() {
       this.isActive = false;
+      // Fetch the capture before the audio graph goes away, the context closes once the worklet answered
+      this.capturedAtStop = this.requestCapture();
+
+      if (this.statsInterval) {
+         clearInterval(this.statsInterval);
+         this.statsInterval = null;
+         this.latencyReportAtStop = this.latencyReport();
+      }
 
       if (this.animationId) {
          cancelAnimationFrame(this.animationId);
@@ -253,9 +416,22 @@ class GuitarTuner {
          this.scriptProcessor.disconnect();
          this.scriptProcessor = null;
       }
+      this.callbackTimer = null;
+      this.workletStats = null;
+
+      if (this.workletNode) {
+         const port = this.workletNode.port;
+         this.capturedAtStop.finally(() => {
+            port.onmessage = null;
+         });
+         this.workletNode.disconnect();
+         this.workletNode = null;
+      }
+      this.pitchRing = null;
 
       if (this.audioContext) {
-         this.audioContext.close();
+         const context = this.audioContext;
+         this.capturedAtStop.finally(() => context.close());
          this.audioContext = null;
       }
 
@@ -266,31 +442,32 @@ class GuitarTuner {
       this.startBtn.classList.remove("bg-red-600", "hover:bg-red-700");
       this.startBtn.classList.add("bg-green-600", "hover:bg-green-700");
       this.tuningControls.style.display = "block"; // Show tuning controls when stopped
-      this.noteDisplay.textContent = "A";
-      this.frequencyDisplay.textContent = `${this.a4Frequency}.00 Hz`;
-      this.needle.setAttribute("transform", "rotate(0, 100, 100)");
+      this.display.reset("A", `${this.a4Frequency}.00 Hz`);
+      this.applyDisplay();
+      this.applyNeedle(0);
    }
 
+   // Runs the analyser path's detection, it has no audio callback of its own
    processAudio() {
-      if (!this.isActive || !this.analyser || !this.dataArray || !this.pitchDetector) {
+      if (!this.analyser || !this.dataArray || !this.pitchDetector) {
          return;
       }
 
       // Get smoothed audio data and extract PCM chunk
+      const inputTime = performance.now();
       this.analyser.getFloatTimeDomainData(this.dataArray);
-      const chunk = this.dataArray.slice(0, this.pitchDetector.chunkSize); // FRAME_SIZE = 2048
+      const chunk = this.dataArray.subarray(0, this.pitchDetector.chunkSize); // FRAME_SIZE = 2048
       try {
          const result = this.pitchDetector.processAudioChunk(chunk);
          if (result) {
-            this.updateDisplay(result.note, result.frequency, result.cents);
+            this.publishDetection(result.note, result.frequency, result.cents, inputTime);
          }
       } catch (error) {
          console.error("Error processing audio:", error);
       }
-      this.animationId = requestAnimationFrame(() => this.processAudio());
    }
 
-   processRawAudioChunk(audioData: Float32Array) {
+   processRawAudioChunk(audioData: Float32Array, inputTime: number) {
       if (!this.isActive || !this.pitchDetector) {
          return;
       }
@@ -298,78 +475,244 @@ class GuitarTuner {
       try {
          const result = this.pitchDetector.processAudioChunk(audioData);
          if (result) {
-            this.updateDisplay(result.note, result.frequency, result.cents);
+            this.publishDetection(result.note, result.frequency, result.cents, inputTime);
          }
       } catch (error) {
          console.error("Error processing raw audio:", error);
       }
    }
 
-   updateDisplay(note: string, frequency: number, cents: number) {
-      this.noteDisplay.textContent = note;
-      this.frequencyDisplay.textContent = `${frequency.toFixed(2)} Hz`;
+   // Drains detections the worklet wrote into the shared ring since the last frame
+   pollPitchRing() {
+      if (!this.pitchRing) {
+         return;
+      }
+
+      const record = this.pitchRecord;
+      while (this.pitchRing.pop(record)) {
+         const inputTime = this.audioTimeToPerformance(record.time);
+         this.publishDetection(NOTE_NAMES[record.noteIndex], record.frequency, record.cents, inputTime);
+      }
+   }
+
+   handleWorkletMessage(message: PitchWorkletMessage) {
+      // Capture replies also arrive after stop, which asks for the capture
+      if (message.type === "capture") {
+         this.workletCapture?.append(message.ring);
+         this.captureSpare = message.ring.samples;
+         this.captureReply?.();
+         this.captureReply = null;
+         return;
+      }
+      if (!this.isActive) {
+         return;
+      }
+
+      if (message.type === "pitch") {
+         const inputTime = this.audioTimeToPerformance(message.time);
+         this.publishDetection(message.note, message.frequency, message.cents, inputTime);
+      } else if (message.type === "stats") {
+         this.workletStats = message;
+      }
+   }
+
+   // Copy of the raw input captured so far, null without capture
+   private requestCapture(): Promise<CapturedPcm | null> {
+      const sampleRate = this.audioContext?.sampleRate ?? 0;
+      if (this.pcmCapture) {
+         const capture = this.pcmCapture;
+         return Promise.resolve({ samples: capture.copy(), startFrame: capture.startFrame, sampleRate });
+      }
+      const node = this.workletNode;
+      const capture = this.workletCapture;
+      if (!node || !capture) {
+         return Promise.resolve(null);
+      }
+
+      return new Promise((resolve) => {
+         const timeout = window.setTimeout(() => resolve(null), CAPTURE_TIMEOUT_MS);
+         this.captureReply = () => {
+            clearTimeout(timeout);
+            resolve({ samples: capture.copy(), startFrame: capture.startFrame, sampleRate });
+         };
+         const empty = this.captureSpare ?? new Float32Array(capture.capacity);
+         this.captureSpare = null;
+         const command: PitchWorkletCommand = { type: "capture", empty };
+         node.port.postMessage(command, [empty.buffer]);
+      });
+   }
+
+   // Maps an audio clock time to performance.now() time. The graph renders ahead of the output
+   // timestamp by the base and output latency. Browsers do not expose the input latency.
+   private audioTimeToPerformance(time: number): number {
+      const context = this.audioContext;
+      if (!context) return performance.now();
+      const stamp = context.getOutputTimestamp?.();
+      if (!stamp?.contextTime || !stamp.performanceTime) {
+         return performance.now() - (context.currentTime - time) * 1000;
+      }
+      const renderAhead = (context.baseLatency || 0) + (context.outputLatency || 0);
+      return stamp.performanceTime + (time - stamp.contextTime - renderAhead) * 1000;
+   }
 
+   // Called by the audio paths for every detection. Only records it and overwrites the latest
+   // value slot, the DOM is updated once per animation frame by renderFrame.
+   // inputTime is the performance.now() time the last analysed sample was available.
+   publishDetection(note: string, frequency: number, cents: number, inputTime: number) {
       // Record debug data (record all attempts, including NaN values)
       if (this.isActive) {
          const timestamp = performance.now() - this.debugStartTime;
-         this.debugRecording.push({
-            timestamp,
-            frequency,
-            note,
-            cents
-         });
+         this.debugRecording.push(timestamp, frequency, note, cents);
       }
 
-      // Handle NaN values - keep last valid cents for needle display
-      let displayCents = cents;
-      if (Number.isNaN(cents) || Number.isNaN(frequency)) {
+      const latest = this.latest;
+      latest.pending = true;
+      latest.note = note;
+      latest.frequency = frequency;
+      latest.cents = cents;
+      latest.inputTime = inputTime;
+   }
+
+   // The only place the tuner display is updated while running. Polls the paths without an audio
+   // callback, renders the latest detection if there is a new one and moves the needle.
+   // time is the frame's timestamp from requestAnimationFrame.
+   renderFrame(time: number) {
+      if (!this.isActive) {
+         return;
+      }
+
+      if (this.analyser) this.processAudio();
+      if (this.pitchRing) this.pollPitchRing();
+
+      const latest = this.latest;
+      if (latest.pending) {
+         latest.pending = false;
+         this.renderDetection(latest.note, latest.frequency, latest.cents, latest.inputTime);
+         this.needleLatency.record(Math.max(0, performance.now() - latest.inputTime));
+      }
+
+      this.applyNeedle(this.display.frame(time));
+      this.animationId = requestAnimationFrame(this.frameCallback);
+   }
+
+   renderDetection(note: string, frequency: number, cents: number, inputTime: number) {
+      // Handle NaN values - the needle keeps heading for the last valid cents
+      if (!this.display.detection(note, frequency, cents, inputTime)) {
          console.warn("Invalid frequency or cents:", { frequency, cents });
-         displayCents = this.lastValidCents; // Use last valid value for needle
-      } else {
-         this.lastValidCents = cents; // Update last valid value
       }
+      this.applyDisplay();
+   }
 
-      const maxCents = 50;
-      const clampedCents = Math.max(-maxCents, Math.min(maxCents, displayCents));
-      const angle = (clampedCents / maxCents) * 80;
+   // Writes only the parts of the display that changed since the last call
+   private applyDisplay() {
+      const { note, frequencyText, accuracy } = this.display;
+      const rendered = this.rendered;
+      if (note !== rendered.note) {
+         this.noteDisplay.textContent = note;
+         rendered.note = note;
+      }
+      if (frequencyText !== rendered.frequencyText) {
+         this.frequencyDisplay.textContent = frequencyText;
+         rendered.frequencyText = frequencyText;
+      }
+      if (accuracy !== rendered.accuracy) {
+         this.noteDisplay.className = `text-6xl font-mono font-bold ${ACCURACY_STYLES[accuracy].noteClass} mb-2`;
+         this.needle.setAttribute("stroke", ACCURACY_STYLES[accuracy].stroke);
+         rendered.accuracy = accuracy;
+      }
+   }
 
-      this.needle.setAttribute("transform", `rotate(${angle}, 100, 100)`);
+   // The needle turns via a CSS transform, which does not invalidate the layout of the rest of
+   // the page. A settled spring does not write at all, a tenth of a degree is below what the
+   // needle can show.
+   private applyNeedle(angle: number) {
+      const roundedAngle = Math.round(angle * 10) / 10;
+      if (roundedAngle !== this.rendered.angle) {
+         this.needle.style.transform = `rotate(${roundedAngle}deg)`;
+         this.rendered.angle = roundedAngle;
+      }
+   }
 
-      if (Math.abs(cents) < 5) {
-         this.noteDisplay.className = "text-6xl font-mono font-bold text-green-400 mb-2";
-         this.needle.setAttribute("stroke", "#22c55e");
-      } else if (Math.abs(cents) < 15) {
-         this.noteDisplay.className = "text-6xl font-mono font-bold text-yellow-400 mb-2";
-         this.needle.setAttribute("stroke", "#eab308");
-      } else {
-         this.noteDisplay.className = "text-6xl font-mono font-bold text-red-400 mb-2";
-         this.needle.setAttribute("stroke", "#ef4444");
+   private latencyReport(): LatencyReport {
+      const path = this.workletNode ? "worklet" : this.scriptProcessor ? "script-processor" : "analyser";
+      const worklet = path === "worklet" ? this.workletStats : null;
+      return {
+         path,
+         detector: worklet ? worklet.detector : (this.pitchDetector?.stats() ?? null),
+         callbackJitter: worklet ? worklet.callbackJitter : (this.callbackTimer?.jitter.snapshot() ?? null),
+         lateCallbacks: worklet ? worklet.lateCallbacks : (this.callbackTimer?.late ?? 0),
+         needleLatency: this.needleLatency.snapshot(),
+         droppedDetections: this.pitchRing?.dropped ?? 0,
+         detectionsPerSecond: this.detectionsPerSecond,
+      };
+   }
+
+   private refreshStats() {
+      const report = this.latencyReport();
+      const detections = report.detector?.detections ?? 0;
+      const time = performance.now();
+      this.detectionsPerSecond = ((detections - this.rateDetections) * 1000) / (time - this.rateTime);
+      this.rateDetections = detections;
+      this.rateTime = time;
+      report.detectionsPerSecond = this.detectionsPerSecond;
+
+      if (!this.statsOverlay || this.statsOverlay.hidden) return;
+      const lines = [`path      ${report.path}`];
+      if (report.detector) {
+         lines.push(formatLatency("compute", report.detector.computeTime));
+         lines.push(`          ${report.detector.lateChunks} late of ${report.detector.analyses} chunks`);
+         lines.push(`          ${report.detector.outliers} outliers rejected`);
       }
+      if (report.callbackJitter) {
+         lines.push(formatLatency("callback", report.callbackJitter));
+         lines.push(`          ${report.lateCallbacks} late callbacks`);
+      }
+      lines.push(formatLatency("needle", report.needleLatency));
+      lines.push(`detect    ${report.detectionsPerSecond.toFixed(1)}/s, ${report.droppedDetections} dropped`);
+      this.statsOverlay.textContent = lines.join("\n");
    }
 
    private exportDebugData() {
       console.log("Debug export requested. Recording length:", this.debugRecording.length);
       console.log("Is active:", this.isActive);
-      console.log("Sample recordings:", this.debugRecording.slice(0, 3));
+      console.log("Overwritten recordings:", this.debugRecording.overwritten);
 
       if (this.debugRecording.length === 0) {
          alert(`No debug data recorded. Recording length: ${this.debugRecording.length}, Is active: ${this.isActive}. Start the tuner and play some notes first.`);
          return;
       }
 
-      // Save to localStorage
-      const debugData = {
-         recordings: this.debugRecording,
-         duration: this.debugRecording[this.debugRecording.length - 1]?.timestamp || 0,
-         a4Frequency: this.a4Frequency,
-         exportTime: new Date().toISOString()
-      };
-
-      localStorage.setItem("tuner-debug-data", JSON.stringify(debugData));
-      console.log("Debug data saved to localStorage", debugData);
-      
-      // Open debug page
-      window.open("debug.html", "_blank");
+      const id = Date.now().toString();
+      const latency = this.isActive ? this.latencyReport() : this.latencyReportAtStop;
+      const capture = this.isActive ? this.requestCapture() : this.capturedAtStop;
+
+      // Open debug page right away, a window opened after the asynchronous save would be treated as a popup.
+      // The page waits for the session to show up in IndexedDB or on the BroadcastChannel.
+      window.open(`debug.html#${id}`, "_blank");
+      capture.then(async (pcm) => {
+         const metadata = {
+            duration: this.debugRecording.lastTimestamp,
+            overwritten: this.debugRecording.overwritten,
+            a4Frequency: this.a4Frequency,
+            outlierFilter: this.outlierFilter,
+            latency,
+            // Replaying the capture with the live detector's hops needs the position of its first sample
+            capture: pcm && { sampleRate: pcm.sampleRate, startFrame: pcm.startFrame, frames: pcm.samples.length },
+            exportTime: new Date().toISOString()
+         };
+         const session: StoredDebugSession = {
+            id,
+            session: new Blob([this.debugRecording.encode(metadata)], { type: "application/octet-stream" }),
+            pcm: pcm ? new Blob([encodeWav(pcm.samples, pcm.sampleRate)], { type: "audio/wav" }) : null,
+         };
+
+         if (await saveDebugSession(session)) {
+            console.log(`Debug session ${id} saved to IndexedDB, ${session.session.size} bytes`, metadata);
+            this.debugSessions.announce(id);
+         } else {
+            this.debugSessions.serve(session);
+         }
+      });
    }
 }
 
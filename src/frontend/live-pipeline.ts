@@ -0,0 +1,30 @@
+import type { OutlierStrategy } from "../outlier-filter.js";
+import type { PitchDetectorOptions } from "../pitch-detector.js";
+
+// Settings of the live tuner's detection paths. The replay harness in src/test/replay.ts builds
+// its detectors from the same values, so a replay runs exactly what the browser runs.
+
+export const LIVE_THRESHOLD = 0.1;
+export const LIVE_FMIN = 40.0; // Lower minimum for baritone guitars
+
+// Frames per AudioWorklet process() call
+export const RENDER_QUANTUM = 128;
+// ~11ms between detections at 48kHz, the analysis window stays 2048 samples
+export const WORKLET_HOP_SIZE = 512;
+// ScriptProcessorNode buffer size, one analysis per callback
+export const SCRIPT_PROCESSOR_BUFFER = 2048;
+
+// Keeps pluck transients off the needle, ?filter=<strategy> picks another one
+export const LIVE_OUTLIER_FILTER: OutlierStrategy = "transient";
+// Harmonic picks during the attack are corrected to the recent fundamental
+export const LIVE_OCTAVE_CORRECTION = true;
+
+// Detector engine on the audio thread. Falls back to the scalar loop, and with it early exit,
+// without WebAssembly SIMD.
+export const WORKLET_ENGINE: Partial<PitchDetectorOptions> = {
+   engine: "wasm",
+   decimate: true,
+   adaptiveWindow: true,
+   earlyExit: true,
+   reuseResult: true,
+};
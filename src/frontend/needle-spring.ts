@@ -0,0 +1,74 @@
+// Needle motion between detections. Detections arrive every ~10-43ms, the display refreshes
+// at 60-120Hz. The needle follows a critically damped spring, fast without overshoot, towards
+// the latest cents value extrapolated along its rate of change, which also makes up for part
+// of the detection latency.
+
+// Spring stiffness in rad/s, the needle covers ~90% of a step in 4 / NEEDLE_OMEGA seconds
+const NEEDLE_OMEGA = 30;
+// Extrapolate at most this far past a detection, beyond that the next one is overdue
+const MAX_EXTRAPOLATION_MS = 60;
+// Pitch glides faster than this are treated as detection noise
+const MAX_RATE_CENTS_PER_SECOND = 200;
+// Weight of the newest rate estimate in the smoothed rate of change
+const RATE_SMOOTHING = 0.5;
+// The needle's range, targets beyond it would only delay the return from the end stop
+const MAX_CENTS = 50;
+
+export class NeedleSpring {
+   cents = 0;
+   velocity = 0; // cents per second
+
+   private target = 0;
+   private targetTime = 0;
+   private rate = 0;
+   private time = -1;
+
+   // New detection at timeMs. sameNote tells whether the rate of change since the previous
+   // target is meaningful, a note change restarts from a standing target.
+   setTarget(cents: number, timeMs: number, sameNote: boolean): void {
+      if (sameNote && this.targetTime > 0 && timeMs > this.targetTime) {
+         const rate = ((cents - this.target) * 1000) / (timeMs - this.targetTime);
+         const clamped = Math.max(-MAX_RATE_CENTS_PER_SECOND, Math.min(MAX_RATE_CENTS_PER_SECOND, rate));
+         this.rate += RATE_SMOOTHING * (clamped - this.rate);
+      } else {
+         this.rate = 0;
+      }
+      this.target = cents;
+      this.targetTime = timeMs;
+   }
+
+   // Advances the spring to timeMs and returns the needle's cents. Uses the exact solution of the
+   // critically damped spring in the frame of a target moving at the estimated rate, so a steady
+   // glide is followed without lag. Stable for any step.
+   update(timeMs: number): number {
+      const dt = this.time < 0 ? 0 : Math.max(0, timeMs - this.time) / 1000;
+      this.time = timeMs;
+
+      const extrapolating = timeMs - this.targetTime < MAX_EXTRAPOLATION_MS;
+      const ahead = Math.min(MAX_EXTRAPOLATION_MS, Math.max(0, timeMs - this.targetTime)) / 1000;
+      let target = this.target + this.rate * ahead;
+      let targetVelocity = extrapolating ? this.rate : 0;
+      if (Math.abs(target) > MAX_CENTS) {
+         target = Math.sign(target) * MAX_CENTS;
+         targetVelocity = 0;
+      }
+
+      // Offset from where the target was at the start of the step
+      const offset = this.cents - (target - targetVelocity * dt);
+      const relativeVelocity = this.velocity - targetVelocity;
+      const impulse = (relativeVelocity + NEEDLE_OMEGA * offset) * dt;
+      const decay = Math.exp(-NEEDLE_OMEGA * dt);
+      this.cents = target + (offset + impulse) * decay;
+      this.velocity = targetVelocity + (relativeVelocity - NEEDLE_OMEGA * impulse) * decay;
+      return this.cents;
+   }
+
+   reset(cents = 0): void {
+      this.cents = cents;
+      this.velocity = 0;
+      this.target = cents;
+      this.targetTime = 0;
+      this.rate = 0;
+      this.time = -1;
+   }
+}
@@ -0,0 +1,122 @@
+// Opt-in capture of the raw microphone input for offline replay. Runs on the audio thread,
+// so writing only copies into a preallocated ring that keeps the most recent samples, and an
+// export swaps the ring for an empty one the main thread sent along.
+// Exported as a 32-bit float WAV, which keeps the samples bit-exact and is read by
+// src/test/test-wav-file.ts and the batch analysis tool.
+
+export const DEFAULT_CAPTURE_SECONDS = 60;
+// Ten minutes at 48kHz are 110MB of float samples, more is not worth the memory
+export const MAX_CAPTURE_SECONDS = 600;
+
+// Ring of a capture handed over by PcmCapture.take, frames samples ending before write (wrapping)
+// and endFrame, the stream index after the newest one
+export interface CaptureRing {
+   samples: Float32Array;
+   write: number;
+   frames: number;
+   endFrame: number;
+}
+
+export class PcmCapture {
+   private samples: Float32Array;
+   private write = 0;
+   private held = 0;
+   private total = 0;
+
+   constructor(capacity: number) {
+      this.samples = new Float32Array(capacity);
+   }
+
+   get capacity(): number {
+      return this.samples.length;
+   }
+
+   push(input: Float32Array): void {
+      const capacity = this.samples.length;
+      // Only the newest capacity samples of a larger input survive
+      const source = input.length > capacity ? input.subarray(input.length - capacity) : input;
+      const head = Math.min(source.length, capacity - this.write);
+      this.samples.set(source.subarray(0, head), this.write);
+      this.samples.set(source.subarray(head), 0);
+      this.write = (this.write + source.length) % capacity;
+      this.held = Math.min(capacity, this.held + input.length);
+      this.total += input.length;
+   }
+
+   // Number of samples held, at most the capacity
+   get frames(): number {
+      return this.held;
+   }
+
+   // Index of the oldest held sample in the whole input stream, e.g. to line up the
+   // analysis hops of a replay with the ones of the live session
+   get startFrame(): number {
+      return this.total - this.held;
+   }
+
+   // Copy of the held samples, oldest first
+   copy(): Float32Array {
+      const result = new Float32Array(this.held);
+      const start = (this.write - this.held + this.samples.length) % this.samples.length;
+      const head = Math.min(this.held, this.samples.length - start);
+      result.set(this.samples.subarray(start, start + head));
+      result.set(this.samples.subarray(0, this.held - head), head);
+      return result;
+   }
+
+   // Hands the ring over without copying and continues in empty, a buffer of the same capacity.
+   // The audio thread only swaps buffers, the receiver puts the samples in order with append.
+   take(empty: Float32Array): CaptureRing {
+      if (empty.length !== this.samples.length) {
+         throw new Error(`Capture buffer of ${empty.length} samples, expected ${this.samples.length}`);
+      }
+      const ring: CaptureRing = { samples: this.samples, write: this.write, frames: this.held, endFrame: this.total };
+      this.samples = empty;
+      this.write = 0;
+      this.held = 0;
+      return ring;
+   }
+
+   // Continues with the samples another capture handed over with take. When they do not follow
+   // on the held ones, that capture overflowed in between and the held samples are dropped.
+   append(ring: CaptureRing): void {
+      const start = ring.endFrame - ring.frames;
+      if (start !== this.total) {
+         this.write = 0;
+         this.held = 0;
+         this.total = start;
+      }
+      const capacity = ring.samples.length;
+      const oldest = (ring.write - ring.frames + capacity) % capacity;
+      const head = Math.min(ring.frames, capacity - oldest);
+      this.push(ring.samples.subarray(oldest, oldest + head));
+      this.push(ring.samples.subarray(0, ring.frames - head));
+   }
+}
+
+// Mono IEEE float WAV file of the samples
+export function encodeWav(samples: Float32Array, sampleRate: number): ArrayBuffer {
+   const dataSize = samples.length * 4;
+   const buffer = new ArrayBuffer(44 + dataSize);
+   const view = new DataView(buffer);
+   const text = (offset: number, value: string) => {
+      for (let i = 0; i < value.length; i++) view.setUint8(offset + i, value.charCodeAt(i));
+   };
+
+   text(0, "RIFF");
+   view.setUint32(4, 36 + dataSize, true);
+   text(8, "WAVE");
+   text(12, "fmt ");
+   view.setUint32(16, 16, true);
+   view.setUint16(20, 3, true); // IEEE float
+   view.setUint16(22, 1, true); // Channels
+   view.setUint32(24, sampleRate, true);
+   view.setUint32(28, sampleRate * 4, true); // Byte rate
+   view.setUint16(32, 4, true); // Block align
+   view.setUint16(34, 32, true); // Bits per sample
+   text(36, "data");
+   view.setUint32(40, dataSize, true);
+   // WAV is little endian, like every platform running the tuner
+   new Float32Array(buffer, 44, samples.length).set(samples);
+   return buffer;
+}
@@ -0,0 +1,87 @@
+// Single-producer/single-consumer ring of pitch detections on a SharedArrayBuffer.
+// The AudioWorklet writes, the main thread reads. Indices are free-running Int32
+// counters published with Atomics, so neither side ever blocks or copies via postMessage.
+
+const WRITE_INDEX = 0;
+const READ_INDEX = 1;
+const DROPPED = 2;
+const HEADER_SIZE = 4; // Int32 slots, padded to 16 bytes so the records stay 8 byte aligned
+
+const RECORD_SIZE = 4; // frequency, cents, note index, audio time
+
+export interface PitchRecord {
+   frequency: number;
+   cents: number;
+   noteIndex: number;
+   time: number; // Audio clock time in seconds at the end of the analysed window
+}
+
+export class PitchRing {
+   readonly buffer: SharedArrayBuffer;
+   readonly capacity: number;
+
+   private header: Int32Array;
+   private records: Float64Array;
+   private mask: number;
+
+   // capacity must be a power of two
+   static create(capacity = 64): PitchRing {
+      const bytes = HEADER_SIZE * Int32Array.BYTES_PER_ELEMENT + capacity * RECORD_SIZE * Float64Array.BYTES_PER_ELEMENT;
+      return new PitchRing(new SharedArrayBuffer(bytes));
+   }
+
+   // SharedArrayBuffer only exists in cross-origin isolated pages (COOP/COEP headers)
+   static isSupported(): boolean {
+      return typeof SharedArrayBuffer !== "undefined" && globalThis.crossOriginIsolated === true;
+   }
+
+   constructor(buffer: SharedArrayBuffer) {
+      this.buffer = buffer;
+      this.header = new Int32Array(buffer, 0, HEADER_SIZE);
+      const recordsOffset = HEADER_SIZE * Int32Array.BYTES_PER_ELEMENT;
+      this.records = new Float64Array(buffer, recordsOffset);
+      this.capacity = this.records.length / RECORD_SIZE;
+      if ((this.capacity & (this.capacity - 1)) !== 0) {
+         throw new Error(`PitchRing capacity must be a power of two, got ${this.capacity}`);
+      }
+      this.mask = this.capacity - 1;
+   }
+
+   // Producer side. Returns false and counts a drop if the consumer fell a full ring behind.
+   push(frequency: number, cents: number, noteIndex: number, time: number): boolean {
+      const write = Atomics.load(this.header, WRITE_INDEX);
+      const read = Atomics.load(this.header, READ_INDEX);
+      if (((write - read) | 0) >= this.capacity) {
+         Atomics.add(this.header, DROPPED, 1);
+         return false;
+      }
+
+      const offset = (write & this.mask) * RECORD_SIZE;
+      this.records[offset] = frequency;
+      this.records[offset + 1] = cents;
+      this.records[offset + 2] = noteIndex;
+      this.records[offset + 3] = time;
+      // Publish the record only after its fields are written
+      Atomics.store(this.header, WRITE_INDEX, (write + 1) | 0);
+      return true;
+   }
+
+   // Consumer side. Copies the oldest unread record into target, returns false if empty.
+   pop(target: PitchRecord): boolean {
+      const read = Atomics.load(this.header, READ_INDEX);
+      const write = Atomics.load(this.header, WRITE_INDEX);
+      if (read === write) return false;
+
+      const offset = (read & this.mask) * RECORD_SIZE;
+      target.frequency = this.records[offset];
+      target.cents = this.records[offset + 1];
+      target.noteIndex = this.records[offset + 2];
+      target.time = this.records[offset + 3];
+      Atomics.store(this.header, READ_INDEX, (read + 1) | 0);
+      return true;
+   }
+
+   get dropped(): number {
+      return Atomics.load(this.header, DROPPED);
+   }
+}
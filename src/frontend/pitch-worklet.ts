@@ -0,0 +1,134 @@
+import { CallbackTimer, type LatencySnapshot, now } from "../latency-stats.js";
+import type { OutlierStrategy } from "../outlier-filter.js";
+import { NOTE_NAMES, PitchDetector, type PitchDetectorStats } from "../pitch-detector.js";
+import { WORKLET_ENGINE } from "./live-pipeline.js";
+import { type CaptureRing, PcmCapture } from "./pcm-capture.js";
+import { PitchRing } from "./pitch-ring.js";
+
+// AudioWorkletGlobalScope is not part of the DOM lib
+declare const sampleRate: number;
+declare const currentTime: number;
+declare class AudioWorkletProcessor {
+   readonly port: MessagePort;
+   constructor(options?: AudioWorkletNodeOptions);
+}
+declare function registerProcessor(
+   name: string,
+   processorCtor: new (options: AudioWorkletNodeOptions) => AudioWorkletProcessor,
+): void;
+
+export interface PitchProcessorOptions {
+   threshold: number;
+   fMin: number;
+   a4Frequency: number;
+   hopSize: number;
+   outlierFilter: OutlierStrategy;
+   octaveCorrection: boolean;
+   // Shared detection ring, only passed when the page is cross-origin isolated
+   ring?: SharedArrayBuffer;
+   // Keep the raw input of the last captureSeconds for the debug export (default: no capture)
+   captureSeconds?: number;
+}
+
+// Worklet -> main thread. time is the audio clock time at the end of the analysed window.
+export type PitchWorkletMessage =
+   | { type: "pitch"; frequency: number; note: string; cents: number; time: number }
+   | { type: "stats"; detector: PitchDetectorStats; callbackJitter: LatencySnapshot; lateCallbacks: number }
+   // Reply to a capture command, the ring captured since the previous one. Its endFrame is an index
+   // in the worklet's input, the detector analysed every hopSize samples from index 0 on.
+   | { type: "capture"; ring: CaptureRing };
+
+// Audio time between two stats messages
+const STATS_INTERVAL_SECONDS = 0.5;
+
+// Main thread -> worklet
+// A capture command brings the empty ring the worklet continues in, of captureSeconds samples
+export type PitchWorkletCommand = { type: "a4"; frequency: number } | { type: "capture"; empty: Float32Array };
+
+// Runs the pitch detector on the audio rendering thread and only publishes detections,
+// so main thread layout, GC and UI work can not stall the analysis. Detections go into
+// a shared PitchRing when available, otherwise they are posted via the message port.
+class PitchProcessor extends AudioWorkletProcessor {
+   private detector: PitchDetector;
+   private ring: PitchRing | null;
+   private callbackTimer: CallbackTimer;
+   private framesUntilStats: number;
+   private capture: PcmCapture | null;
+
+   constructor(options: AudioWorkletNodeOptions) {
+      super(options);
+      const processorOptions = options.processorOptions as PitchProcessorOptions;
+      this.detector = new PitchDetector({
+         sampleRate,
+         threshold: processorOptions.threshold,
+         fMin: processorOptions.fMin,
+         a4Frequency: processorOptions.a4Frequency,
+         hopSize: processorOptions.hopSize,
+         outlierFilter: processorOptions.outlierFilter,
+         octaveCorrection: processorOptions.octaveCorrection,
+         ...WORKLET_ENGINE,
+      });
+      this.ring = processorOptions.ring ? new PitchRing(processorOptions.ring) : null;
+      // A callback a whole analysis window behind means the audio thread could not keep up
+      this.callbackTimer = new CallbackTimer(sampleRate, (this.detector.chunkSize * 1000) / sampleRate);
+      this.framesUntilStats = Math.round(sampleRate * STATS_INTERVAL_SECONDS);
+      const captureSeconds = processorOptions.captureSeconds ?? 0;
+      this.capture = captureSeconds > 0 ? new PcmCapture(Math.round(captureSeconds * sampleRate)) : null;
+
+      this.port.onmessage = (event: MessageEvent<PitchWorkletCommand>) => {
+         if (event.data.type === "a4") {
+            this.detector.setA4Frequency(event.data.frequency);
+         } else if (event.data.type === "capture" && this.capture) {
+            // Only the buffers change hands, the audio thread copies nothing
+            const ring = this.capture.take(event.data.empty);
+            const message: PitchWorkletMessage = { type: "capture", ring };
+            this.port.postMessage(message, [ring.samples.buffer]);
+         }
+      };
+   }
+
+   process(inputs: Float32Array[][]): boolean {
+      const input = inputs[0];
+      if (input.length === 0) return true;
+      const frames = input[0].length;
+      this.callbackTimer.tick(now(), frames);
+      this.capture?.push(input[0]);
+
+      // With a hop of at least one render quantum there is at most one detection per call
+      const result = this.detector.pushSamples(input[0]);
+      const time = currentTime + frames / sampleRate;
+      if (result && this.ring) {
+         this.ring.push(result.frequency, result.cents, NOTE_NAMES.indexOf(result.note), time);
+      } else if (result) {
+         const message: PitchWorkletMessage = {
+            type: "pitch",
+            frequency: result.frequency,
+            note: result.note,
+            cents: result.cents,
+            time,
+         };
+         this.port.postMessage(message);
+      }
+
+      this.framesUntilStats -= frames;
+      if (this.framesUntilStats <= 0) {
+         this.framesUntilStats += Math.round(sampleRate * STATS_INTERVAL_SECONDS);
+         this.postStats();
+      }
+
+      return true;
+   }
+
+   // Twice a second, the snapshots allocate
+   private postStats() {
+      const message: PitchWorkletMessage = {
+         type: "stats",
+         detector: this.detector.stats(),
+         callbackJitter: this.callbackTimer.jitter.snapshot(),
+         lateCallbacks: this.callbackTimer.late,
+      };
+      this.port.postMessage(message);
+   }
+}
+
+registerProcessor("pitch-processor", PitchProcessor);
@@ -0,0 +1,53 @@
+import { NeedleSpring } from "./needle-spring.js";
+
+// What the tuner shows for a stream of detections, without the DOM. GuitarTuner renders it,
+// the replay harness in src/test/replay.ts runs the same logic headless.
+
+export type Accuracy = "inTune" | "close" | "off";
+
+// Needle range in cents either side of the note, mapped to ±MAX_ANGLE degrees
+const MAX_CENTS = 50;
+const MAX_ANGLE = 80;
+
+export function accuracyOf(cents: number): Accuracy {
+   return Math.abs(cents) < 5 ? "inTune" : Math.abs(cents) < 15 ? "close" : "off";
+}
+
+export function needleAngle(cents: number): number {
+   return (Math.max(-MAX_CENTS, Math.min(MAX_CENTS, cents)) / MAX_CENTS) * MAX_ANGLE;
+}
+
+export class TunerDisplay {
+   note = "A";
+   frequencyText = "";
+   accuracy: Accuracy = "inTune";
+   lastValidCents = 0; // Keep track of last valid cents for needle
+
+   private needleSpring = new NeedleSpring(); // Moves the needle towards lastValidCents every frame
+
+   // Shows a detection. Returns false for NaN values, the needle then keeps heading for the last
+   // valid cents. inputTime is the time the last analysed sample was available.
+   detection(note: string, frequency: number, cents: number, inputTime: number): boolean {
+      const valid = !Number.isNaN(cents) && !Number.isNaN(frequency);
+      if (valid) {
+         this.lastValidCents = cents; // Update last valid value
+         this.needleSpring.setTarget(this.lastValidCents, inputTime, note === this.note);
+      }
+      this.note = note;
+      this.frequencyText = `${frequency.toFixed(2)} Hz`;
+      this.accuracy = accuracyOf(cents);
+      return valid;
+   }
+
+   // Advances the needle to a frame at time, returns its angle in degrees
+   frame(time: number): number {
+      return needleAngle(this.needleSpring.update(time));
+   }
+
+   reset(note: string, frequencyText: string): void {
+      this.note = note;
+      this.frequencyText = frequencyText;
+      this.lastValidCents = 0;
+      this.needleSpring.reset();
+   }
+}
@@ -0,0 +1,106 @@
+// Always-on latency instrumentation. Recording only touches preallocated counters, so it can
+// run on the audio thread for every chunk. Snapshots allocate and are meant for the UI and exports.
+
+// Upper bounds of the histogram buckets in milliseconds, doubling from 1/16ms. Values above
+// the last bound land in an overflow bucket.
+export const LATENCY_BUCKETS_MS = [0.0625, 0.125, 0.25, 0.5, 1, 2, 4, 8, 16, 32, 64, 128, 256];
+
+export interface LatencySnapshot {
+   count: number;
+   meanMs: number;
+   maxMs: number;
+   p50Ms: number; // Upper bound of the bucket holding the percentile
+   p99Ms: number;
+   buckets: number[]; // Counts per LATENCY_BUCKETS_MS bound, plus the overflow bucket
+}
+
+// performance is not exposed in every AudioWorkletGlobalScope
+export const now: () => number =
+   typeof performance !== "undefined" ? () => performance.now() : () => Date.now();
+
+export class LatencyHistogram {
+   readonly counts = new Uint32Array(LATENCY_BUCKETS_MS.length + 1);
+   count = 0;
+   totalMs = 0;
+   maxMs = 0;
+
+   record(ms: number): void {
+      let bucket = 0;
+      while (bucket < LATENCY_BUCKETS_MS.length && ms > LATENCY_BUCKETS_MS[bucket]) bucket++;
+      this.counts[bucket]++;
+      this.count++;
+      this.totalMs += ms;
+      if (ms > this.maxMs) this.maxMs = ms;
+   }
+
+   // Upper bound of the bucket containing the given percentile (0-100), the maximum for the overflow bucket
+   percentile(p: number): number {
+      if (this.count === 0) return 0;
+      const rank = Math.ceil((p / 100) * this.count);
+      let seen = 0;
+      for (let bucket = 0; bucket < LATENCY_BUCKETS_MS.length; bucket++) {
+         seen += this.counts[bucket];
+         if (seen >= rank) return Math.min(LATENCY_BUCKETS_MS[bucket], this.maxMs);
+      }
+      return this.maxMs;
+   }
+
+   reset(): void {
+      this.counts.fill(0);
+      this.count = 0;
+      this.totalMs = 0;
+      this.maxMs = 0;
+   }
+
+   snapshot(): LatencySnapshot {
+      return {
+         count: this.count,
+         meanMs: this.count > 0 ? this.totalMs / this.count : 0,
+         maxMs: this.maxMs,
+         p50Ms: this.percentile(50),
+         p99Ms: this.percentile(99),
+         buckets: Array.from(this.counts),
+      };
+   }
+}
+
+// Measures how late periodic audio callbacks run against the audio clock. The offset of the
+// wall clock to the audio consumed so far is smallest for a callback that ran on time, the
+// excess over that minimum is the callback's jitter. Browsers run several render quanta back
+// to back per device buffer, so jitter includes the device buffering. A callback more than
+// lateMs behind counts as late and becomes the new reference, audio was lost or the clocks
+// drifted apart.
+export class CallbackTimer {
+   readonly jitter = new LatencyHistogram();
+   late = 0;
+
+   private sampleRate: number;
+   private lateMs: number;
+   private audioMs = 0;
+   private minOffset = Number.POSITIVE_INFINITY;
+
+   constructor(sampleRate: number, lateMs: number) {
+      this.sampleRate = sampleRate;
+      this.lateMs = lateMs;
+   }
+
+   // Call at the start of every callback with the number of frames it delivers
+   tick(timeMs: number, frames: number): void {
+      const offset = timeMs - this.audioMs;
+      if (offset < this.minOffset) this.minOffset = offset;
+      const lag = offset - this.minOffset;
+      this.jitter.record(lag);
+      if (lag > this.lateMs) {
+         this.late++;
+         this.minOffset = offset;
+      }
+      this.audioMs += (frames * 1000) / this.sampleRate;
+   }
+
+   reset(): void {
+      this.jitter.reset();
+      this.late = 0;
+      this.audioMs = 0;
+      this.minOffset = Number.POSITIVE_INFINITY;
+   }
+}
@@ -0,0 +1,269 @@
+// Streaming outlier rejection between the YIN search and the frequency smoothing. Ports the
+// offline filters, filterPluckTransients in src/test/test-wav-file.ts and the moving-window,
+// rate-change, adaptive-regime and hybrid filters of debug.html, to a causal form: every
+// detection is accepted or rejected on arrival in constant time from a few numbers of state,
+// so the needle never waits for later detections. Rejected detections never reach the needle.
+//
+// Thresholds are the offline ones. Those given per reading assumed the 2048-sample chunks at
+// 44.1kHz, live detections come every hop, so they are scaled by the time between readings, and
+// so is the number of readings that confirm a new note.
+
+export type OutlierStrategy = "none" | "transient" | "moving-window" | "rate-change" | "adaptive-regime" | "hybrid";
+
+export const OUTLIER_STRATEGIES: OutlierStrategy[] = [
+   "none",
+   "transient",
+   "moving-window",
+   "rate-change",
+   "adaptive-regime",
+   "hybrid",
+];
+
+// Interval the per reading thresholds were tuned for, 2048 samples at 44.1kHz
+const READING_MS = 46.4;
+
+// transient: a kept reading may move at most 0.6% per reading from the last kept one, and at
+// least 3Hz to let small wobbles through
+const TRANSIENT_RELATIVE_CHANGE = 0.006;
+const TRANSIENT_MIN_HZ = 3;
+
+// moving-window: median of the last kept readings, 3x as lenient while fewer than 3 are kept
+const WINDOW_SIZE = 5;
+const WINDOW_THRESHOLD_HZ = 10;
+
+// rate-change: change from the previous detection, kept or not
+const RATE_CHANGE_HZ = 20;
+
+// adaptive-regime: readings within STABLE of the regime's mean join it, readings up to CHANGE
+// away may start a new regime, anything further is rejected
+const REGIME_STABLE_HZ = 1.5;
+const REGIME_CHANGE_HZ = 15;
+
+// hybrid: guitar range, jump limit and deviation from the median of the recent detections.
+// The offline version used a window centred on the reading, live only the past half exists.
+const HYBRID_MIN_HZ = 50;
+const HYBRID_MAX_HZ = 500;
+const HYBRID_MAX_JUMP_HZ = 80;
+const HYBRID_MAX_DEVIATION_HZ = 30;
+
+// Consecutive rejected readings that agree with each other and replace the reference, so a
+// filter that only compares against kept readings follows a new note instead of rejecting it
+// forever. Given at READING_MS, shorter intervals need as many readings as span the same time.
+const CONFIRM_READINGS = 3;
+
+// Without a detection for this long the next one starts afresh, e.g. the next pluck
+const RESET_MS = 250;
+
+export class OutlierFilter {
+   readonly strategy: OutlierStrategy;
+   private readonly intervalMs: number;
+
+   // Last kept reading and the time since, in detector intervals
+   private kept = 0;
+   private sinceKept = 0;
+   // Last detection whether kept or not, for rate-change and hybrid
+   private previous = 0;
+   private sincePrevious = 0;
+
+   // Recent readings, kept ones for moving-window, in-range ones for hybrid
+   private window = new Float64Array(WINDOW_SIZE);
+   private windowStart = 0;
+   private windowCount = 0;
+   private sorted = new Float64Array(WINDOW_SIZE);
+
+   // adaptive-regime: running mean of the current regime, candidate readings for the next one
+   private regimeSum = 0;
+   private regimeCount = 0;
+   private readonly confirmReadings: number;
+   private candidates: Float64Array;
+   private candidateCount = 0;
+
+   // Every detector interval is intervalMs, e.g. the hop of the streaming detector
+   constructor(strategy: OutlierStrategy, intervalMs: number) {
+      if (!OUTLIER_STRATEGIES.includes(strategy)) {
+         throw new Error(`Unknown outlier filter ${strategy}`);
+      }
+      this.strategy = strategy;
+      this.intervalMs = intervalMs;
+      this.confirmReadings = Math.max(CONFIRM_READINGS, Math.round((CONFIRM_READINGS * READING_MS) / intervalMs));
+      this.candidates = new Float64Array(this.confirmReadings);
+   }
+
+   // Returns whether a detected frequency is kept
+   accept(frequency: number): boolean {
+      this.sinceKept++;
+      this.sincePrevious++;
+      const intervals = this.sincePrevious;
+      if (this.previous > 0 && intervals * this.intervalMs > RESET_MS) {
+         this.reset();
+      }
+
+      let keep = true;
+      switch (this.strategy) {
+         case "transient": {
+            const passed = this.kept === 0 || this.withinTransient(frequency, this.kept, this.readings(this.sinceKept));
+            keep = this.confirmed(frequency, passed);
+            break;
+         }
+         case "moving-window":
+            keep = this.confirmed(frequency, this.windowCount === 0 || this.withinWindow(frequency));
+            break;
+         case "rate-change":
+            keep =
+               this.previous === 0 || Math.abs(frequency - this.previous) <= RATE_CHANGE_HZ * this.readings(intervals);
+            break;
+         case "adaptive-regime":
+            keep = this.regime(frequency);
+            break;
+         case "hybrid":
+            keep = this.hybrid(frequency);
+            break;
+      }
+
+      if (this.strategy !== "hybrid") {
+         this.previous = frequency;
+         this.sincePrevious = 0;
+      }
+      if (keep) {
+         this.kept = frequency;
+         this.sinceKept = 0;
+         if (this.strategy === "moving-window") this.pushWindow(frequency);
+      }
+      return keep;
+   }
+
+   // An analysis without a detection
+   miss(): void {
+      this.sinceKept++;
+      this.sincePrevious++;
+   }
+
+   reset(): void {
+      this.kept = 0;
+      this.sinceKept = 0;
+      this.previous = 0;
+      this.sincePrevious = 0;
+      this.windowStart = 0;
+      this.windowCount = 0;
+      this.regimeSum = 0;
+      this.regimeCount = 0;
+      this.candidateCount = 0;
+   }
+
+   // Per reading thresholds scale with the time elapsed, never below one reading's worth
+   private readings(intervals: number): number {
+      return Math.max(1, (intervals * this.intervalMs) / READING_MS);
+   }
+
+   private withinTransient(frequency: number, reference: number, readings: number): boolean {
+      const threshold = Math.max(reference * TRANSIENT_RELATIVE_CHANGE * readings, TRANSIENT_MIN_HZ);
+      return Math.abs(frequency - reference) <= threshold;
+   }
+
+   private withinWindow(frequency: number): boolean {
+      const threshold = this.windowCount < 3 ? WINDOW_THRESHOLD_HZ * 3 : WINDOW_THRESHOLD_HZ;
+      return Math.abs(frequency - this.windowMedian()) <= threshold;
+   }
+
+   // Upper median like the offline filters, insertion sort of at most WINDOW_SIZE readings
+   private windowMedian(): number {
+      const count = this.windowCount;
+      const sorted = this.sorted;
+      for (let i = 0; i < count; i++) {
+         const value = this.window[(this.windowStart + i) % WINDOW_SIZE];
+         let j = i;
+         for (; j > 0 && sorted[j - 1] > value; j--) sorted[j] = sorted[j - 1];
+         sorted[j] = value;
+      }
+      return sorted[Math.floor(count / 2)];
+   }
+
+   private pushWindow(frequency: number): void {
+      if (this.windowCount < WINDOW_SIZE) {
+         this.window[(this.windowStart + this.windowCount) % WINDOW_SIZE] = frequency;
+         this.windowCount++;
+      } else {
+         this.window[this.windowStart] = frequency;
+         this.windowStart = (this.windowStart + 1) % WINDOW_SIZE;
+      }
+   }
+
+   // Keeps a reading that passed, or the confirmReadings-th of a run of rejected readings that
+   // pass the transient test against each other. The run then becomes the new reference.
+   private confirmed(frequency: number, passed: boolean): boolean {
+      if (passed) {
+         this.candidateCount = 0;
+         return true;
+      }
+      const count = this.candidateCount;
+      if (count > 0 && this.withinTransient(frequency, this.candidates[count - 1], 1)) {
+         this.candidates[this.candidateCount++] = frequency;
+      } else {
+         this.candidates[0] = frequency;
+         this.candidateCount = 1;
+      }
+      if (this.candidateCount < this.confirmReadings) return false;
+
+      if (this.strategy === "moving-window") {
+         this.windowCount = 0;
+         for (let i = 0; i < this.confirmReadings - 1; i++) this.pushWindow(this.candidates[i]);
+      }
+      this.candidateCount = 0;
+      return true;
+   }
+
+   private regime(frequency: number): boolean {
+      if (this.regimeCount === 0) {
+         this.regimeSum = frequency;
+         this.regimeCount = 1;
+         return true;
+      }
+
+      const deviation = Math.abs(frequency - this.regimeSum / this.regimeCount);
+      if (deviation <= REGIME_STABLE_HZ) {
+         this.regimeSum += frequency;
+         this.regimeCount++;
+         this.candidateCount = 0;
+         return true;
+      }
+      if (deviation > REGIME_CHANGE_HZ) {
+         this.candidateCount = 0;
+         return false;
+      }
+
+      // Possible start of a new regime, promoted once confirmReadings candidates agree
+      const confirm = this.confirmReadings;
+      if (this.candidateCount === confirm) {
+         this.candidates.copyWithin(0, 1);
+         this.candidateCount--;
+      }
+      this.candidates[this.candidateCount++] = frequency;
+      if (this.candidateCount < confirm) return false;
+
+      let sum = 0;
+      for (let i = 0; i < confirm; i++) sum += this.candidates[i];
+      const mean = sum / confirm;
+      for (let i = 0; i < confirm; i++) {
+         if (Math.abs(this.candidates[i] - mean) > REGIME_STABLE_HZ) return false;
+      }
+      this.regimeSum = sum;
+      this.regimeCount = confirm;
+      this.candidateCount = 0;
+      return true;
+   }
+
+   private hybrid(frequency: number): boolean {
+      // Stage 1: physics bounds, such readings do not count as previous detections either
+      if (frequency < HYBRID_MIN_HZ || frequency > HYBRID_MAX_HZ) return false;
+
+      // Stage 2: jump from the previous in-range detection
+      const jump = this.previous > 0 && Math.abs(frequency - this.previous) > HYBRID_MAX_JUMP_HZ;
+      this.previous = frequency;
+      this.sincePrevious = 0;
+      this.pushWindow(frequency);
+      if (jump) return false;
+
+      // Stage 3: deviation from the median of the recent in-range detections, this one included
+      return this.windowCount < 3 || Math.abs(frequency - this.windowMedian()) <= HYBRID_MAX_DEVIATION_HZ;
+   }
+}
@@ -1,7 +1,20 @@
+import { Decimator, decimationFactor } from "./decimator.js";
+import { FFT, nextPowerOfTwo } from "./fft.js";
+import { LatencyHistogram, type LatencySnapshot, now } from "./latency-stats.js";
+import { OutlierFilter, type OutlierStrategy } from "./outlier-filter.js";
+import { WasmYinKernel } from "./wasm-yin.js";
+
 export interface PitchResult {
-   frequency: number;
+   frequency: number; // Smoothed
    note: string;
    cents: number;
+   rawFrequency: number; // This analysis' frequency before smoothing
+   // 1 minus the CMNDF minimum at the detected period, YIN's aperiodicity. 1 is perfectly periodic,
+   // detections start at 1 - threshold, octave corrected ones may go lower.
+   confidence: number;
+   // RMS of the analysed window: the whole frame, or only its end while a tracked pitch narrows
+   // the analysis
+   windowRms: number;
 }
 
 export interface PitchDetectorOptions {
@@ -10,21 +23,154 @@ export interface PitchDetectorOptions {
    threshold?: number; // YIN threshold (default: 0.1)
    fMin?: number; // Minimum frequency (default: 40.0)
    a4Frequency?: number; // A4 reference frequency (default: 440.0)
+   engine?: YinEngine; // Difference function engine (default: "direct")
+   reuseResult?: boolean; // Return the same PitchResult object on every call (default: false)
+   hopSize?: number; // pushSamples analysis interval in samples (default: chunkSize, no overlap)
+   adaptiveWindow?: boolean; // Shrink window and tau range around a stable pitch (default: false)
+   earlyExit?: boolean; // Direct engine: stop at the first confirmed CMNDF dip (default: false)
+   tauRange?: [number, number]; // Restrict the period search to lags [tauLo, tauHi], see setTauRange
+   decimate?: boolean; // Search a decimated signal, then refine around its period at full rate (default: false)
+   outlierFilter?: OutlierStrategy; // Reject implausible detections before smoothing (default: "none")
+   octaveCorrection?: boolean; // Prefer the period consistent with recent detections over its harmonics (default: false)
+}
+
+export interface PitchDetectorStats {
+   computeTime: LatencySnapshot; // Time per analysis
+   analyses: number;
+   detections: number;
+   outliers: number; // Detections rejected by the outlier filter
+   lateChunks: number; // Analyses that took longer than the audio of one hop lasts
 }
 
+// "direct" evaluates the YIN difference function with the O(N·maxTau) double loop,
+// "fft" derives it from an FFT autocorrelation plus running energy terms in O(N log N),
+// "wasm" runs the direct loop and the CMNDF in a WebAssembly SIMD kernel, falling back to
+// "direct" where WebAssembly SIMD is unavailable.
+export type YinEngine = "direct" | "fft" | "wasm";
+
+// Hops between full recomputations of the incrementally updated difference function,
+// bounds the accumulated rounding error of the running sums
+const DIFF_REFRESH_HOPS = 64;
+
+// Coarse-to-fine search: decimated CMNDF dips below threshold * COARSE_THRESHOLD_FACTOR are
+// verified at full rate. Lowpassing makes dips shallower or deeper, the margin keeps the coarse
+// pass from skipping a dip the full rate search would take.
+const COARSE_THRESHOLD_FACTOR = 3;
+
+// Adaptive window: once two consecutive raw detections agree within ADAPTIVE_STABLE_CENTS,
+// lags are searched up to ADAPTIVE_TAU_RANGE periods (a fifth below the tracked note) and the
+// window keeps ADAPTIVE_PERIODS periods of integration on top of that
+const ADAPTIVE_STABLE_CENTS = 50;
+const ADAPTIVE_TAU_RANGE = 1.5;
+const ADAPTIVE_PERIODS = 2.5;
+
+// Octave correction: a pick at one of HARMONIC_RATIOS times the recent period (a strong second
+// harmonic, a weak fundamental) is compared with the CMNDF dip at the recent period. The picked
+// dip has to beat the consistent one by OCTAVE_WEIGHT per octave of distance to the recent pitch.
+// Both dips are searched within OCTAVE_BAND of their lag, so the correction costs a few dozen
+// lags of the difference function and only runs when a pick disagrees with the history.
+const HARMONIC_RATIOS = [2, 3, 0.5, 1 / 3];
+const OCTAVE_TOLERANCE = 1 / 24; // Half a semitone, in octaves
+const OCTAVE_BAND = 0.015;
+const OCTAVE_WEIGHT = 0.2;
+const OCTAVE_MAX_CMNDF_FACTOR = 3; // The consistent dip must stay below threshold * factor
+// A pick that keeps disagreeing for this long is a real note change, longer than an attack
+const OCTAVE_CONFIRM_MS = 125;
+// The history is forgotten after this long without a detection
+const OCTAVE_HOLD_MS = 500;
+
+export const NOTE_NAMES = ["C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"];
+
 export class PitchDetector {
    readonly sampleRate: number; // Will be set from AudioContext
    readonly chunkSize = 2048;
+   readonly hopSize: number;
 
    private dataArray: Float32Array;
    private debug: boolean;
    private threshold: number;
    private fMin: number;
    private a4Frequency: number;
-   
-   // Frequency smoothing
-   private frequencyHistory: number[] = [];
+   private engine: YinEngine;
+   private readonly maxTau: number;
+
+   // YIN scratch buffers, allocated once so the steady state does not allocate
+   private diff: Float32Array;
+   private cmndf: Float32Array;
+
+   // FFT engine state (only allocated when engine is "fft")
+   private fft: FFT | null = null;
+   private autocorrelation: Float64Array | null = null;
+
+   // WASM engine state, diff and cmndf are views onto the kernel's memory
+   private kernel: WasmYinKernel | null = null;
+
+   // Note table, rebuilt only when the A4 reference changes
+   private noteNames: string[] = [];
+   private noteFrequencies: Float64Array = new Float64Array(0);
+
+   // Frequency smoothing, ring buffer of the last maxHistorySize raw frequencies
    private readonly maxHistorySize = 4;
+   private frequencyHistory = new Float64Array(this.maxHistorySize);
+   private historyStart = 0;
+   private historyCount = 0;
+
+   // Streaming state for pushSamples: circular window holding the latest chunkSize samples
+   private streamWindow: Float32Array;
+   private windowWrite = 0;
+   private samplesUntilHop: number;
+
+   // Incrementally updated difference function for overlapping windows (direct engine only).
+   // Each hop retires the sample pairs that left the window and adds the ones that entered.
+   private readonly incremental: boolean;
+   private previousFrame: Float32Array;
+   private runningDiff: Float64Array;
+   private runningDiffValid = false;
+   private hopsSinceRefresh = 0;
+
+   // Early exit and caller supplied lag window
+   private earlyExit: boolean;
+   private tauLo = 0;
+   private tauHi = Number.POSITIVE_INFINITY;
+
+   // Decimation front end (only allocated when decimate is set and the sample rate allows it)
+   private decimator: Decimator | null = null;
+   private decimated: Float32Array = new Float32Array(0);
+   private candidates: Float64Array = new Float64Array(0);
+
+   // Running sums of the frame for the closed form CMNDF normalisation of a lag band
+   private prefixSum: Float64Array;
+   private prefixSquares: Float64Array;
+
+   // Adaptive window state, trackedPeriod is 0 while no stable pitch is tracked
+   private adaptiveWindow: boolean;
+   private trackedPeriod = 0;
+   private lastRawFrequency = 0;
+
+   // Octave correction state, the period of the last detection and the analyses since
+   private octaveCorrection: boolean;
+   private referencePeriod = 0;
+   private referenceAge = 0;
+   private octaveCorrections = 0;
+   private bandTau = 0;
+
+   // Outlier rejection between the search and the smoothing, null for "none"
+   private outlierFilter: OutlierFilter | null;
+
+   // Always-on instrumentation, recording does not allocate
+   readonly computeTime = new LatencyHistogram();
+   analyses = 0;
+   detections = 0;
+   outliers = 0;
+   lateChunks = 0;
+   private readonly hopBudgetMs: number;
+
+   // Result object handed out when reuseResult is set
+   private reuseResult: boolean;
+   private result: PitchResult = { frequency: 0, note: "", cents: 0, rawFrequency: 0, confidence: 0, windowRms: 0 };
+
+   // CMNDF value at the period the last search picked
+   private pickedCmndf = 1;
 
    constructor(options: PitchDetectorOptions) {
       this.sampleRate = options.sampleRate;
@@ -33,14 +179,116 @@ export class PitchDetector {
       this.threshold = options.threshold || 0.1;
       this.fMin = options.fMin || 40.0;
       this.a4Frequency = options.a4Frequency || 440.0;
+      this.engine = options.engine || "direct";
+      if (this.engine === "wasm" && !WasmYinKernel.isSupported()) {
+         this.engine = "direct";
+      }
+      this.reuseResult = options.reuseResult || false;
+      this.adaptiveWindow = options.adaptiveWindow || false;
+      this.earlyExit = options.earlyExit || false;
+      this.octaveCorrection = options.octaveCorrection || false;
+      if (options.tauRange) {
+         this.setTauRange(options.tauRange[0], options.tauRange[1]);
+      }
+      this.hopSize = options.hopSize || this.chunkSize;
+      if (this.hopSize < 1 || this.hopSize > this.chunkSize) {
+         throw new Error(`Hop size must be between 1 and ${this.chunkSize} samples`);
+      }
+      this.hopBudgetMs = (this.hopSize * 1000) / this.sampleRate;
+      const outlierFilter = options.outlierFilter ?? "none";
+      this.outlierFilter = outlierFilter === "none" ? null : new OutlierFilter(outlierFilter, this.hopBudgetMs);
+
+      this.maxTau = Math.floor(this.sampleRate / this.fMin);
+      if (this.engine === "wasm") {
+         this.kernel = new WasmYinKernel(this.chunkSize, this.maxTau);
+         this.diff = this.kernel.diff;
+         this.cmndf = this.kernel.cmndf;
+      } else {
+         this.diff = new Float32Array(this.maxTau);
+         this.cmndf = new Float32Array(this.maxTau);
+      }
+      if (this.engine === "fft") {
+         this.fft = new FFT(nextPowerOfTwo(this.chunkSize + this.maxTau));
+         this.autocorrelation = new Float64Array(this.maxTau);
+      }
+
+      const factor = options.decimate ? decimationFactor(this.sampleRate, this.fMin) : 1;
+      if (factor > 1) {
+         this.decimator = new Decimator(factor);
+         this.decimated = new Float32Array(this.decimator.outputLength(this.chunkSize));
+         this.candidates = new Float64Array(Math.ceil(this.maxTau / factor));
+      }
+      this.prefixSum = new Float64Array(this.chunkSize + 1);
+      this.prefixSquares = new Float64Array(this.chunkSize + 1);
+
+      this.streamWindow = new Float32Array(this.chunkSize);
+      this.samplesUntilHop = this.chunkSize;
+      // Retiring and adding pairs costs 2 * hopSize per lag versus chunkSize for a full pass
+      this.incremental = this.engine === "direct" && 2 * this.hopSize < this.chunkSize;
+      this.previousFrame = new Float32Array(this.chunkSize);
+      this.runningDiff = new Float64Array(this.incremental ? this.maxTau : 0);
+
+      this.generateNoteFrequencies();
 
       if (this.debug) {
          console.log(
-            `PitchDetectorYIN initialized: ${this.sampleRate}Hz, ${this.chunkSize} samples, threshold: ${this.threshold}, A4: ${this.a4Frequency}Hz`,
+            `PitchDetectorYIN initialized: ${this.sampleRate}Hz, ${this.chunkSize} samples, threshold: ${this.threshold}, A4: ${this.a4Frequency}Hz, engine: ${this.engine}`,
          );
       }
    }
 
+   setA4Frequency(a4Frequency: number) {
+      if (a4Frequency === this.a4Frequency) return;
+      this.a4Frequency = a4Frequency;
+      this.generateNoteFrequencies();
+   }
+
+   // Only accept periods between tauLo and tauHi samples, e.g. derived from the string being
+   // tuned. Lags above tauHi are never computed. Lags below tauLo can not be picked, the early
+   // exit search gets their share of the CMNDF normalisation from a closed form sum.
+   setTauRange(tauLo: number, tauHi: number) {
+      this.tauLo = Math.max(0, Math.floor(tauLo));
+      this.tauHi = Math.max(this.tauLo + 2, Math.ceil(tauHi) + 2);
+   }
+
+   clearTauRange() {
+      this.tauLo = 0;
+      this.tauHi = Number.POSITIVE_INFINITY;
+   }
+
+   stats(): PitchDetectorStats {
+      return {
+         computeTime: this.computeTime.snapshot(),
+         analyses: this.analyses,
+         detections: this.detections,
+         outliers: this.outliers,
+         lateChunks: this.lateChunks,
+      };
+   }
+
+   resetStats() {
+      this.computeTime.reset();
+      this.analyses = 0;
+      this.detections = 0;
+      this.outliers = 0;
+      this.lateChunks = 0;
+   }
+
+   // Forget the smoothing history and streaming window, e.g. when the input source changes
+   reset() {
+      this.historyStart = 0;
+      this.historyCount = 0;
+      this.streamWindow.fill(0);
+      this.windowWrite = 0;
+      this.samplesUntilHop = this.chunkSize;
+      this.runningDiffValid = false;
+      this.trackedPeriod = 0;
+      this.lastRawFrequency = 0;
+      this.referencePeriod = 0;
+      this.octaveCorrections = 0;
+      this.outlierFilter?.reset();
+   }
+
    processAudioChunk(audioChunk: Float32Array): PitchResult | null {
       if (audioChunk.length !== this.chunkSize) {
          throw new Error(`Audio chunk must be exactly ${this.chunkSize} samples`);
@@ -48,13 +296,118 @@ export class PitchDetector {
 
       // Copy the audio chunk directly (YIN processes each chunk independently)
       this.dataArray.set(audioChunk);
+      this.runningDiffValid = false;
+
+      return this.analyzeBuffer(false);
+   }
+
+   // Streaming entry point. Accepts any number of samples and analyses the latest chunkSize
+   // samples every hopSize samples once the window has filled. Returns the last detection
+   // made during this call, onResult is invoked for every detection.
+   pushSamples(samples: Float32Array, onResult?: (result: PitchResult) => void): PitchResult | null {
+      const n = this.chunkSize;
+      const streamWindow = this.streamWindow;
+      let last: PitchResult | null = null;
+
+      for (let i = 0; i < samples.length; i++) {
+         streamWindow[this.windowWrite] = samples[i];
+         if (++this.windowWrite === n) this.windowWrite = 0;
+         if (--this.samplesUntilHop > 0) continue;
+
+         this.samplesUntilHop = this.hopSize;
+         const result = this.analyzeWindow();
+         if (result) {
+            last = result;
+            onResult?.(result);
+         }
+      }
+
+      return last;
+   }
+
+   private analyzeWindow(): PitchResult | null {
+      const n = this.chunkSize;
+
+      // Keep the previous frame around, the incremental update needs the pairs leaving the window
+      const previous = this.dataArray;
+      const frame = this.previousFrame;
+      this.previousFrame = previous;
+      this.dataArray = frame;
+
+      // Linearise the circular window, oldest sample first
+      const streamWindow = this.streamWindow;
+      for (let i = 0, j = this.windowWrite; i < n; i++) {
+         frame[i] = streamWindow[j];
+         if (++j === n) j = 0;
+      }
+
+      // A tracked pitch analyses a shorter window, the running sums cover the full one
+      if (!this.incremental || this.trackedPeriod > 0) {
+         this.runningDiffValid = false;
+         return this.analyzeBuffer(false);
+      }
+
+      const runningDiff = this.runningDiff;
+      if (this.runningDiffValid && this.hopsSinceRefresh < DIFF_REFRESH_HOPS) {
+         this.updateDifference(previous, frame, runningDiff);
+         this.hopsSinceRefresh++;
+      } else {
+         this.directDifference(frame, 0, runningDiff, this.maxTau);
+         this.runningDiffValid = true;
+         this.hopsSinceRefresh = 0;
+      }
+
+      const diff = this.diff;
+      for (let tau = 1; tau < this.maxTau; tau++) {
+         // Clamp rounding noise of the running sums, the true sum of squares is never negative
+         diff[tau] = Math.max(0, runningDiff[tau]);
+      }
+      return this.analyzeBuffer(true);
+   }
+
+   // Slides the difference function of previous by hopSize samples to that of frame:
+   // pairs (i, i + tau) with i < hopSize left the window, pairs ending in the last
+   // hopSize samples of frame entered it.
+   private updateDifference(previous: Float32Array, frame: Float32Array, diff: Float64Array): void {
+      const n = this.chunkSize;
+      const hop = this.hopSize;
+      for (let tau = 1; tau < this.maxTau; tau++) {
+         let sum = diff[tau];
+
+         const leaving = Math.min(hop, n - tau);
+         for (let i = 0; i < leaving; i++) {
+            const d = previous[i] - previous[i + tau];
+            sum -= d * d;
+         }
+
+         for (let j = Math.max(n - hop, tau); j < n; j++) {
+            const d = frame[j - tau] - frame[j];
+            sum += d * d;
+         }
 
-      return this.analyzeBuffer();
+         diff[tau] = sum;
+      }
    }
 
-   private analyzeBuffer(): PitchResult | null {
-      const startTime = performance.now();
-      const frequency = this.yinPitch(this.dataArray, this.sampleRate);
+   // When diffReady is set, this.diff already holds the difference function of the frame
+   private analyzeBuffer(diffReady: boolean): PitchResult | null {
+      const startTime = now();
+
+      // Around a tracked pitch, only analyse the most recent samples and the lags near its period
+      let start = 0;
+      let maxTau = this.maxTau;
+      if (this.trackedPeriod > 0 && !diffReady) {
+         maxTau = Math.min(this.maxTau, Math.ceil(this.trackedPeriod * ADAPTIVE_TAU_RANGE) + 2);
+         start = this.chunkSize - Math.min(this.chunkSize, maxTau + Math.ceil(this.trackedPeriod * ADAPTIVE_PERIODS));
+      }
+
+      maxTau = Math.min(maxTau, this.tauHi);
+
+      // A tracked pitch already limits the search to a few lags, decimation only pays off for the full range
+      let frequency =
+         this.decimator && !diffReady && this.trackedPeriod === 0
+            ? this.decimatedPitch(maxTau)
+            : this.searchPitch(this.dataArray, this.sampleRate, diffReady, start, maxTau, this.tauLo);
       if (this.debug) {
          console.log(`Raw YIN frequency: ${frequency}`);
       }
@@ -62,107 +415,436 @@ export class PitchDetector {
          if (this.debug) {
             console.log(`Rejected frequency: ${frequency}`);
          }
+         // Tracking lost, widen back to the full window and tau range
+         this.trackedPeriod = 0;
+         this.lastRawFrequency = 0;
+         this.referenceAge++;
+         this.outlierFilter?.miss();
+         this.recordAnalysis(startTime);
          return null;
       }
-      
+      if (this.octaveCorrection) {
+         frequency = this.correctOctave(frequency);
+      }
+      if (this.adaptiveWindow) {
+         this.trackPitch(frequency);
+      }
+      // The adaptive window keeps following the raw pitch, only the smoothing skips outliers
+      if (this.outlierFilter && !this.outlierFilter.accept(frequency)) {
+         if (this.debug) {
+            console.log(`Outlier rejected: ${frequency}`);
+         }
+         this.outliers++;
+         this.recordAnalysis(startTime);
+         return null;
+      }
+
       // Apply frequency smoothing
       const smoothedFrequency = this.smoothFrequency(frequency);
-      const noteInfo = this.getClosestNote(smoothedFrequency);
-      const totalTime = performance.now() - startTime;
+      const noteIndex = this.getClosestNote(smoothedFrequency);
+      const note = this.noteNames[noteIndex];
+      let cents = 1200 * Math.log2(smoothedFrequency / this.noteFrequencies[noteIndex]);
+      if (Number.isNaN(cents)) {
+         console.warn(`NaN cents calculation: freq=${smoothedFrequency}, closest=${this.noteFrequencies[noteIndex]}`);
+         cents = 0;
+      }
+      const windowRms = this.windowRms(start);
+      const confidence = Math.min(1, Math.max(0, 1 - this.pickedCmndf));
+      const totalTime = this.recordAnalysis(startTime);
+      this.detections++;
+      if (this.debug) {
+         console.log(`YIN detection: ${frequency.toFixed(2)}Hz → ${smoothedFrequency.toFixed(2)}Hz (${note}) in ${totalTime.toFixed(2)}ms`);
+      }
+
+      if (!this.reuseResult) {
+         return { frequency: smoothedFrequency, note, cents, rawFrequency: frequency, confidence, windowRms };
+      }
+      this.result.frequency = smoothedFrequency;
+      this.result.note = note;
+      this.result.cents = cents;
+      this.result.rawFrequency = frequency;
+      this.result.confidence = confidence;
+      this.result.windowRms = windowRms;
+      return this.result;
+   }
+
+   // Only the samples the search looked at, a tracked pitch keeps this to a few periods
+   private windowRms(start: number): number {
+      const frame = this.dataArray;
+      let sum = 0;
+      for (let i = start; i < frame.length; i++) sum += frame[i] * frame[i];
+      return Math.sqrt(sum / (frame.length - start));
+   }
+
+   private recordAnalysis(startTime: number): number {
+      const time = now() - startTime;
+      this.computeTime.record(time);
+      this.analyses++;
+      if (time > this.hopBudgetMs) this.lateChunks++;
+      return time;
+   }
+
+   // Returns the frequency whose period is consistent with the recent detections when the pick
+   // lies at a harmonic ratio of it and the consistent dip scores better. Runs on every detection.
+   private correctOctave(frequency: number): number {
+      const reference = this.referencePeriod;
+      const expired = this.referenceAge * this.hopBudgetMs > OCTAVE_HOLD_MS;
+      this.referenceAge = 0;
+      this.referencePeriod = this.sampleRate / frequency;
+      if (reference === 0 || expired) return frequency;
 
+      const tau = this.sampleRate / frequency;
+      const octaves = Math.log2(tau / reference);
+      let harmonic = 0;
+      for (const ratio of HARMONIC_RATIOS) {
+         if (Math.abs(octaves - Math.log2(ratio)) < OCTAVE_TOLERANCE) harmonic = ratio;
+      }
+      if (harmonic === 0 || this.octaveCorrections * this.hopBudgetMs >= OCTAVE_CONFIRM_MS) {
+         // Consistent, a different note, or a harmonic that persisted long enough to be the note
+         this.octaveCorrections = 0;
+         return frequency;
+      }
+
+      const consistentTau = tau / harmonic;
+      const minTau = Math.max(2, this.tauLo, this.sampleRate / 800);
+      const maxTau = Math.min(this.maxTau, this.tauHi) - 1;
+      if (consistentTau * (1 - OCTAVE_BAND) < minTau || consistentTau * (1 + OCTAVE_BAND) > maxTau) {
+         this.octaveCorrections = 0;
+         return frequency;
+      }
+
+      const picked = this.bandMinimum(tau);
+      const consistent = this.bandMinimum(consistentTau);
+      const penalty = OCTAVE_WEIGHT * Math.abs(Math.log2(harmonic));
+      if (!(consistent < this.threshold * OCTAVE_MAX_CMNDF_FACTOR && consistent < picked + penalty)) {
+         this.octaveCorrections = 0;
+         return frequency;
+      }
+
+      this.octaveCorrections++;
+      this.referencePeriod = this.bandTau;
+      this.pickedCmndf = consistent;
       if (this.debug) {
-         console.log(`YIN detection: ${frequency.toFixed(2)}Hz → ${smoothedFrequency.toFixed(2)}Hz (${noteInfo.note}) in ${totalTime.toFixed(2)}ms`);
+         console.log(`Octave correction: ${frequency.toFixed(2)}Hz → ${(this.sampleRate / this.bandTau).toFixed(2)}Hz`);
       }
+      return this.sampleRate / this.bandTau;
+   }
 
-      return {
-         frequency: smoothedFrequency,
-         note: noteInfo.note,
-         cents: noteInfo.cents,
-      };
+   // Lowest full frame CMNDF value within OCTAVE_BAND of lag tau, its interpolated lag goes to
+   // bandTau. Overwrites that band of diff and cmndf, the search is done with them.
+   private bandMinimum(tau: number): number {
+      const frame = this.dataArray;
+      const n = frame.length;
+      const diff = this.diff;
+      const cmndf = this.cmndf;
+      const from = Math.max(2, Math.floor(tau * (1 - OCTAVE_BAND)));
+      const to = Math.min(this.maxTau - 1, Math.ceil(tau * (1 + OCTAVE_BAND)));
+
+      let runningSum = this.cumulativeDifference(frame, 0, from - 1);
+      let best = from;
+      for (let t = from; t <= to; t++) {
+         let sum = 0;
+         for (let i = 0; i < n - t; i++) {
+            const d = frame[i] - frame[i + t];
+            sum += d * d;
+         }
+         diff[t] = sum;
+         runningSum += diff[t];
+         cmndf[t] = (diff[t] * t) / runningSum;
+         if (cmndf[t] < cmndf[best]) best = t;
+      }
+
+      // The neighbours of an edge minimum were not evaluated
+      this.bandTau = best > from && best < to ? this.parabolic(cmndf, best, to + 1) : best;
+      return cmndf[best];
+   }
+
+   private trackPitch(frequency: number): void {
+      const stable =
+         this.lastRawFrequency > 0 && Math.abs(1200 * Math.log2(frequency / this.lastRawFrequency)) < ADAPTIVE_STABLE_CENTS;
+      this.trackedPeriod = stable ? this.sampleRate / frequency : 0;
+      this.lastRawFrequency = frequency;
    }
 
    private smoothFrequency(newFrequency: number): number {
-      // Add new frequency to history
-      this.frequencyHistory.push(newFrequency);
-      
-      // Limit history size
-      if (this.frequencyHistory.length > this.maxHistorySize) {
-         this.frequencyHistory.shift();
-      }
-      
+      const history = this.frequencyHistory;
+      const size = this.maxHistorySize;
+
+      // Add new frequency to the ring, overwriting the oldest entry once full
+      if (this.historyCount < size) {
+         history[(this.historyStart + this.historyCount) % size] = newFrequency;
+         this.historyCount++;
+      } else {
+         history[this.historyStart] = newFrequency;
+         this.historyStart = (this.historyStart + 1) % size;
+      }
+
       // Calculate weighted average - newer values have more weight
       // Weights: [1, 2, 3, 4] for a 4-sample history
       let weightedSum = 0;
       let totalWeight = 0;
-      
-      for (let i = 0; i < this.frequencyHistory.length; i++) {
+
+      for (let i = 0; i < this.historyCount; i++) {
          const weight = i + 1; // Weight increases with recency
-         weightedSum += this.frequencyHistory[i] * weight;
+         weightedSum += history[(this.historyStart + i) % size] * weight;
          totalWeight += weight;
       }
-      
+
       return weightedSum / totalWeight;
    }
 
-   // YIN Pitch Detection Algorithm
-   private yinPitch(frame: Float32Array, fs: number): number {
-      const fMin = this.fMin;
-      const threshold = this.threshold;
-      const n = frame.length;
-      const maxTau = Math.floor(fs / fMin);
-      const diff = new Float32Array(maxTau);
-      const cmndf = new Float32Array(maxTau);
+   private searchPitch(
+      frame: Float32Array,
+      fs: number,
+      diffReady: boolean,
+      start: number,
+      maxTau: number,
+      tauLo: number,
+   ): number {
+      return this.earlyExit && this.engine === "direct" && !diffReady
+         ? this.yinPitchEarlyExit(frame, fs, start, Math.max(2, tauLo), maxTau - 1, maxTau)
+         : this.yinPitch(frame, fs, diffReady, start, maxTau, tauLo);
+   }
+
+   // Coarse-to-fine search, a heuristic that agreed with the full search on the bundled recordings
+   // and synthetic tones. A full rate dip whose decimated counterpart is no candidate is never
+   // evaluated, so it can miss one. Lags too short to survive the decimator are scanned at full rate. Above that, every dip of the decimated CMNDF is a candidate
+   // and the full rate CMNDF is evaluated only in a band of one decimation step around each one,
+   // until a band holds a lag below the threshold.
+   private decimatedPitch(maxTau: number): number {
+      const decimator = this.decimator!;
+      const factor = decimator.factor;
+      const frame = this.dataArray;
+      const fs = this.sampleRate;
+      const searchStart = Math.max(2, this.tauLo);
+
+      // Periods below 4 * factor samples lie above the decimator's passband
+      const lowEnd = Math.min(maxTau - 1, 4 * factor + 2);
+      let frequency = this.yinPitchEarlyExit(frame, fs, 0, searchStart, lowEnd, maxTau);
+      if (frequency !== -1) return frequency;
+
+      const coarse = this.decimated;
+      decimator.process(frame, 0, coarse);
+      const coarseMaxTau = Math.ceil(maxTau / factor);
+      this.cumulativeMeanNormalizedDifference(coarse, false, 0, coarseMaxTau);
+
+      // Collect candidates first, the fine pass reuses the diff and cmndf buffers
+      const cmndf = this.cmndf;
+      const candidates = this.candidates;
+      const candidateThreshold = this.threshold * COARSE_THRESHOLD_FACTOR;
+      let count = 0;
+      for (let tau = Math.max(2, Math.floor(lowEnd / factor)); tau + 1 < coarseMaxTau; tau++) {
+         if (cmndf[tau] < candidateThreshold && cmndf[tau] <= cmndf[tau - 1] && cmndf[tau] < cmndf[tau + 1]) {
+            candidates[count++] = this.parabolic(cmndf, tau, coarseMaxTau) * factor;
+         }
+      }
+
+      for (let i = 0; i < count; i++) {
+         const from = Math.max(lowEnd + 1, searchStart, Math.floor(candidates[i]) - factor);
+         const to = Math.min(maxTau - 1, Math.ceil(candidates[i]) + factor);
+         if (from > to) continue;
+         frequency = this.yinPitchEarlyExit(frame, fs, 0, from, to, maxTau);
+         if (frequency !== -1) return frequency;
+      }
+      return -1;
+   }
+
+   // Sum of the difference function of frame[start, frame.length) over lags 1..maxLag in O(n),
+   // without evaluating it: d(tau) = E(0, n - tau) + E(tau, n) - 2 * sum_i x[i] * x[i + tau], where
+   // E are energies from prefix sums of squares and the cross terms collapse to x[i] times a range
+   // of the prefix sum.
+   private cumulativeDifference(frame: Float32Array, start: number, maxLag: number): number {
+      const n = frame.length - start;
+      const lags = Math.min(maxLag, n - 1);
+      if (lags <= 0) return 0;
+
+      const prefixSum = this.prefixSum;
+      const prefixSquares = this.prefixSquares;
+      prefixSum[0] = 0;
+      prefixSquares[0] = 0;
+      for (let i = 0; i < n; i++) {
+         const x = frame[start + i];
+         prefixSum[i + 1] = prefixSum[i] + x;
+         prefixSquares[i + 1] = prefixSquares[i] + x * x;
+      }
+
+      let energies = 0;
+      for (let tau = 1; tau <= lags; tau++) {
+         energies += prefixSquares[n - tau] + prefixSquares[n] - prefixSquares[tau];
+      }
+
+      let cross = 0;
+      for (let i = 0; i < n - 1; i++) {
+         const end = Math.min(i + lags, n - 1);
+         cross += frame[start + i] * (prefixSum[end + 1] - prefixSum[i + 1]);
+      }
+
+      return Math.max(0, energies - 2 * cross);
+   }
+
+   // Difference function and CMNDF of frame[start, frame.length) into diff/cmndf[0, maxTau)
+   private cumulativeMeanNormalizedDifference(frame: Float32Array, diffReady: boolean, start: number, maxTau: number) {
+      const diff = this.diff;
+      const cmndf = this.cmndf;
 
       // difference function
-      for (let tau = 1; tau < maxTau; tau++) {
-         let sum = 0;
-         for (let i = 0; i < n - tau; i++) {
-            const d = frame[i] - frame[i + tau];
-            sum += d * d;
+      if (!diffReady) {
+         if (this.engine === "fft") {
+            this.fftDifference(frame, start, diff, maxTau);
+         } else if (this.kernel) {
+            this.kernel.difference(frame, start, maxTau);
+         } else {
+            this.directDifference(frame, start, diff, maxTau);
          }
-         diff[tau] = sum;
       }
 
       // cumulative mean normalized difference
-      cmndf[0] = 1;
-      let runningSum = 0;
-      for (let tau = 1; tau < maxTau; tau++) {
-         runningSum += diff[tau];
-         cmndf[tau] = (diff[tau] * tau) / runningSum;
+      if (this.kernel) {
+         this.kernel.cumulativeMeanNormalized(maxTau);
+      } else {
+         cmndf[0] = 1;
+         let runningSum = 0;
+         for (let tau = 1; tau < maxTau; tau++) {
+            runningSum += diff[tau];
+            cmndf[tau] = (diff[tau] * tau) / runningSum;
+         }
       }
+   }
+
+   // YIN Pitch Detection Algorithm
+   // Analyses frame[start, frame.length) for lags below maxTau.
+   private yinPitch(
+      frame: Float32Array,
+      fs: number,
+      diffReady = false,
+      start = 0,
+      maxTau = this.maxTau,
+      tauLo = this.tauLo,
+   ): number {
+      const threshold = this.threshold;
+      const cmndf = this.cmndf;
+      this.cumulativeMeanNormalizedDifference(frame, diffReady, start, maxTau);
 
       // absolute threshold
-      let tau = 2;
+      let tau = Math.max(2, tauLo);
       while (tau < maxTau && cmndf[tau] > threshold) tau++;
-      if (tau === maxTau) return -1;
+      if (tau >= maxTau) return -1;
 
       // refine: take first local minimum below threshold
       while (tau + 1 < maxTau && cmndf[tau + 1] < cmndf[tau]) tau++;
+      this.pickedCmndf = cmndf[tau];
 
       // parabolic interpolation around tau
-      const betterTau = this.parabolic(cmndf, tau);
+      const betterTau = this.parabolic(cmndf, tau, maxTau);
       return fs / betterTau;
    }
 
+   // Same result as yinPitch with the direct engine, but computes the difference function and
+   // CMNDF together, lag by lag, and stops once the first local minimum below threshold is
+   // confirmed. High strings only need the first few hundred lags. Only dips starting at a lag
+   // in [from, to] are accepted, -1 if there is none. Lags below from - 1 are not evaluated,
+   // their contribution to the CMNDF normalisation comes from cumulativeDifference.
+   private yinPitchEarlyExit(
+      frame: Float32Array,
+      fs: number,
+      start: number,
+      from: number,
+      to: number,
+      maxTau: number,
+   ): number {
+      const threshold = this.threshold;
+      const diff = this.diff;
+      const cmndf = this.cmndf;
+      const n = frame.length;
+
+      cmndf[0] = 1;
+      // Kept out of the loop accumulator, seeding it with a call result keeps it boxed in V8
+      const lowerSum = from > 2 ? this.cumulativeDifference(frame, start, from - 2) : 0;
+      let runningSum = 0;
+      let candidate = -1;
+      for (let tau = from - 1; tau < maxTau; tau++) {
+         let sum = 0;
+         for (let i = start; i < n - tau; i++) {
+            const d = frame[i] - frame[i + tau];
+            sum += d * d;
+         }
+         diff[tau] = sum;
+         // Read back the Float32 value so the normalisation rounds exactly like yinPitch
+         runningSum += diff[tau];
+         cmndf[tau] = (diff[tau] * tau) / (lowerSum + runningSum);
+
+         if (candidate < 0) {
+            if (tau > to) return -1;
+            // Negated so NaN (silent frame) stops the search like the full scan does
+            if (tau >= from && !(cmndf[tau] > threshold)) candidate = tau;
+         } else if (cmndf[tau] < cmndf[candidate]) {
+            candidate = tau;
+         } else {
+            // cmndf[candidate + 1] is known, enough for the parabolic fit
+            this.pickedCmndf = cmndf[candidate];
+            return fs / this.parabolic(cmndf, candidate, tau + 1);
+         }
+      }
+
+      if (candidate < 0) return -1;
+      this.pickedCmndf = cmndf[candidate];
+      return fs / this.parabolic(cmndf, candidate, maxTau);
+   }
+
+   private directDifference(frame: Float32Array, start: number, diff: Float32Array | Float64Array, maxTau: number): void {
+      const n = frame.length;
+      for (let tau = 1; tau < maxTau; tau++) {
+         let sum = 0;
+         for (let i = start; i < n - tau; i++) {
+            const d = frame[i] - frame[i + tau];
+            sum += d * d;
+         }
+         diff[tau] = sum;
+      }
+   }
+
+   // Difference function via d(tau) = e0(tau) + e1(tau) - 2 * r(tau), where r is the
+   // autocorrelation and e0/e1 are the energies of frame[0, n - tau) and frame[tau, n).
+   // Only frame[start, frame.length) is analysed.
+   private fftDifference(frame: Float32Array, start: number, diff: Float32Array, maxTau: number): void {
+      const n = frame.length - start;
+      const r = this.autocorrelation!;
+      this.fft!.autocorrelation(frame, r, maxTau, start, n);
+
+      // r[0] is the energy of the whole frame, shrink both windows as tau grows
+      let e0 = r[0];
+      let e1 = r[0];
+      for (let tau = 1; tau < maxTau; tau++) {
+         if (tau > n) {
+            diff[tau] = 0;
+            continue;
+         }
+         const head = frame[start + tau - 1];
+         const tail = frame[start + n - tau];
+         e0 -= tail * tail;
+         e1 -= head * head;
+         // Clamp rounding noise, the direct sum of squares is never negative
+         diff[tau] = Math.max(0, e0 + e1 - 2 * r[tau]);
+      }
+   }
+
    // quadratic interpolation of discrete minimum
-   private parabolic(arr: Float32Array, i: number): number {
+   private parabolic(arr: Float32Array, i: number, length = arr.length): number {
       const x0 = i > 0 ? arr[i - 1] : arr[i];
       const x1 = arr[i];
-      const x2 = i + 1 < arr.length ? arr[i + 1] : arr[i];
+      const x2 = i + 1 < length ? arr[i + 1] : arr[i];
       const denom = x0 + x2 - 2 * x1;
       return denom === 0 ? i : i + (x0 - x2) / (2 * denom);
    }
 
-   private generateNoteFrequencies(): Array<{ note: string; freq: number }> {
-      const noteFrequencies: Array<{ note: string; freq: number }> = [];
-      const noteNames = ["C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"];
+   private generateNoteFrequencies(): void {
+      const names: string[] = [];
+      const frequencies: number[] = [];
 
       // Generate frequencies for octaves 1-5 (C1 to G5)
       // A4 is the 9th note (index 9) in octave 4
       for (let octave = 1; octave <= 5; octave++) {
          for (let noteIndex = 0; noteIndex < 12; noteIndex++) {
-            const noteName = noteNames[noteIndex];
-
             // Calculate semitone offset from A4
             // A4 is at octave 4, note index 9
             const semitonesFromA4 = (octave - 4) * 12 + (noteIndex - 9);
@@ -172,37 +854,31 @@ export class PitchDetector {
 
             // Only include frequencies in our detection range (32Hz - 800Hz)
             if (frequency >= 30 && frequency <= 800) {
-               noteFrequencies.push({ note: noteName, freq: frequency });
+               names.push(NOTE_NAMES[noteIndex]);
+               frequencies.push(frequency);
             }
          }
       }
 
-      return noteFrequencies;
+      this.noteNames = names;
+      this.noteFrequencies = Float64Array.from(frequencies);
    }
 
-   private getClosestNote(frequency: number): { note: string; cents: number } {
-      const noteFrequencies = this.generateNoteFrequencies();
+   // Index into the note table of the note closest to frequency
+   private getClosestNote(frequency: number): number {
+      const noteFrequencies = this.noteFrequencies;
 
-      let closest = noteFrequencies[0];
-      let minDiff = Math.abs(frequency - closest.freq);
+      let closest = 0;
+      let minDiff = Math.abs(frequency - noteFrequencies[0]);
 
-      for (const note of noteFrequencies) {
-         const diff = Math.abs(frequency - note.freq);
+      for (let i = 1; i < noteFrequencies.length; i++) {
+         const diff = Math.abs(frequency - noteFrequencies[i]);
          if (diff < minDiff) {
             minDiff = diff;
-            closest = note;
+            closest = i;
          }
       }
 
-      const cents = 1200 * Math.log2(frequency / closest.freq);
-
-      if (Number.isNaN(cents)) {
-         console.warn(
-            `NaN cents calculation: freq=${frequency}, closest=${closest.freq}, log2=${Math.log2(frequency / closest.freq)}`,
-         );
-         return { note: closest.note, cents: 0 };
-      }
-
-      return { note: closest.note, cents };
+      return closest;
    }
 }
@@ -0,0 +1,101 @@
+import assert from "node:assert";
+import { PerformanceObserver } from "node:perf_hooks";
+import { test } from "node:test";
+import v8 from "node:v8";
+import vm from "node:vm";
+import { PitchDetector, type YinEngine } from "../pitch-detector.js";
+
+// Equivalent of running node with --expose-gc, so the test also works under plain `npm test`
+v8.setFlagsFromString("--expose-gc");
+const gc = vm.runInNewContext("gc") as () => void;
+
+const SAMPLE_RATE = 48000;
+const WARMUP_CHUNKS = 5000;
+const MEASURED_CHUNKS = 3000;
+// Tier-up and deopts of code shared with the other engine's test can land in a measured run,
+// later attempts start from the already settled JIT state
+const ATTEMPTS = 3;
+
+// Leaves room for late JIT activity and boxed doubles. The real signal is the GC count:
+// the old per-chunk scratch arrays and note table triggered several scavenges per run.
+const MAX_BYTES_PER_CHUNK = 512;
+
+function sine(frequency: number, length: number): Float32Array {
+   const signal = new Float32Array(length);
+   for (let i = 0; i < length; i++) {
+      signal[i] = Math.sin((2 * Math.PI * frequency * i) / SAMPLE_RATE);
+   }
+   return signal;
+}
+
+async function measureAllocations(engine: YinEngine, decimate: boolean) {
+   // A high fMin keeps maxTau, and with it the test runtime, small. Allocation behaviour does not depend on it.
+   const detector = new PitchDetector({ sampleRate: SAMPLE_RATE, fMin: 300, engine, decimate, reuseResult: true });
+
+   // Mix of chunks that detect a pitch and chunks that are rejected
+   const chunks = [
+      sine(440.0, detector.chunkSize),
+      sine(659.25, detector.chunkSize),
+      new Float32Array(detector.chunkSize),
+   ];
+
+   for (let i = 0; i < WARMUP_CHUNKS; i++) {
+      detector.processAudioChunk(chunks[i % chunks.length]);
+   }
+
+   let best = { gcDuringRun: Number.POSITIVE_INFINITY, bytesPerChunk: Number.POSITIVE_INFINITY };
+   for (let attempt = 0; attempt < ATTEMPTS; attempt++) {
+      const run = await measureRun(detector, chunks);
+      const fewerGcs = run.gcDuringRun < best.gcDuringRun;
+      if (fewerGcs || (run.gcDuringRun === best.gcDuringRun && run.bytesPerChunk < best.bytesPerChunk)) {
+         best = run;
+      }
+      if (best.gcDuringRun === 0 && best.bytesPerChunk < MAX_BYTES_PER_CHUNK) break;
+   }
+   return best;
+}
+
+async function measureRun(detector: PitchDetector, chunks: Float32Array[]) {
+   const gcTimes: number[] = [];
+   const observer = new PerformanceObserver((list) => {
+      for (const entry of list.getEntries()) gcTimes.push(entry.startTime);
+   });
+   observer.observe({ entryTypes: ["gc"] });
+
+   gc();
+   const startTime = performance.now();
+   const before = process.memoryUsage();
+   for (let i = 0; i < MEASURED_CHUNKS; i++) {
+      detector.processAudioChunk(chunks[i % chunks.length]);
+   }
+   const after = process.memoryUsage();
+   const endTime = performance.now();
+
+   // GC entries are delivered asynchronously, on a later timer tick
+   await new Promise((resolve) => setTimeout(resolve, 100));
+   observer.disconnect();
+
+   // Typed array backing stores live outside the JS heap, count both
+   const gcDuringRun = gcTimes.filter((time) => time >= startTime && time <= endTime).length;
+   const allocated = after.heapUsed - before.heapUsed + (after.arrayBuffers - before.arrayBuffers);
+   const bytesPerChunk = allocated / MEASURED_CHUNKS;
+   return { gcDuringRun, bytesPerChunk };
+}
+
+const cases: Array<{ engine: YinEngine; decimate: boolean }> = [
+   { engine: "direct", decimate: false },
+   { engine: "fft", decimate: false },
+   { engine: "wasm", decimate: false },
+   { engine: "direct", decimate: true },
+];
+
+for (const { engine, decimate } of cases) {
+   const name = decimate ? `${engine} engine, decimated` : `${engine} engine`;
+   test(`Zero-allocation steady state (${name})`, async () => {
+      const { gcDuringRun, bytesPerChunk } = await measureAllocations(engine, decimate);
+      console.log(`  ${name}: ${bytesPerChunk.toFixed(1)} bytes/chunk, ${gcDuringRun} GCs`);
+
+      assert.strictEqual(gcDuringRun, 0, `${gcDuringRun} GCs while processing ${MEASURED_CHUNKS} chunks`);
+      assert.ok(bytesPerChunk < MAX_BYTES_PER_CHUNK, `${bytesPerChunk.toFixed(1)} bytes allocated per chunk`);
+   });
+}
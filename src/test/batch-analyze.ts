@@ -0,0 +1,236 @@
+import fs from "node:fs";
+import os from "node:os";
+import { isMainThread, parentPort, Worker } from "node:worker_threads";
+import type { YinEngine } from "../pitch-detector.js";
+import {
+   analyzeRange,
+   CHUNK_SIZE,
+   type DetectorSettings,
+   expandInputs,
+   type FileSummary,
+   type RangeResult,
+   summarize,
+   toCsv,
+} from "./batch.js";
+import { PcmFile } from "./wav.js";
+
+// Batch analysis of WAV corpora. The main thread only parses WAV headers and splits each file
+// into ranges of chunks; worker threads read and decode their range themselves with pread, so
+// memory does not grow with the size of the recordings. Per-chunk detections come back as
+// transferred typed arrays and are reduced to one summary per file, written as JSON and/or CSV.
+
+// Chunks per task. Small enough to spread a few long takes over all workers, large enough that
+// the warm-up chunks in front of each range stay a small overhead.
+const SEGMENT_CHUNKS = 256;
+
+interface Task {
+   id: number;
+   path: string;
+   firstChunk: number;
+   lastChunk: number;
+   settings: DetectorSettings;
+}
+
+interface TaskResult {
+   id: number;
+   result: RangeResult;
+   elapsedMs: number;
+}
+
+function runTask(task: Task): TaskResult {
+   const start = performance.now();
+   const file = new PcmFile(task.path);
+   try {
+      const result = analyzeRange(file, task.firstChunk, task.lastChunk, task.settings);
+      return { id: task.id, result, elapsedMs: performance.now() - start };
+   } finally {
+      file.close();
+   }
+}
+
+if (!isMainThread) {
+   const port = parentPort!;
+   port.on("message", (task: Task) => {
+      const message = runTask(task);
+      const { frequencies, cents, noteIndices, confidences } = message.result;
+      port.postMessage(message, [frequencies.buffer, cents.buffer, noteIndices.buffer, confidences.buffer]);
+   });
+}
+
+// File with the detections of its finished ranges
+interface FileJob {
+   path: string;
+   sampleCount: number;
+   sampleRate: number;
+   result: RangeResult;
+   remaining: number;
+   processingMs: number;
+}
+
+async function runBatch(files: string[], settings: DetectorSettings, workerCount: number): Promise<FileSummary[]> {
+   const summaries: FileSummary[] = [];
+   const jobs = new Map<number, { job: FileJob; firstChunk: number }>();
+   let nextTaskId = 0;
+   let fileIndex = 0;
+   let pendingRanges: Task[] = [];
+   let currentJob: FileJob | null = null;
+
+   // Tasks are created lazily, file by file
+   const nextTask = (): { task: Task; job: FileJob } | null => {
+      while (pendingRanges.length === 0) {
+         if (fileIndex >= files.length) return null;
+         const path = files[fileIndex++];
+         const file = new PcmFile(path);
+         file.close();
+         const sampleCount = file.frames;
+         const sampleRate = file.format.sampleRate;
+
+         const chunks = Math.floor(sampleCount / CHUNK_SIZE);
+         const job: FileJob = {
+            path,
+            sampleCount,
+            sampleRate,
+            result: {
+               frequencies: new Float64Array(chunks),
+               cents: new Float64Array(chunks),
+               noteIndices: new Int8Array(chunks),
+               confidences: new Float32Array(chunks),
+            },
+            remaining: Math.ceil(chunks / SEGMENT_CHUNKS),
+            processingMs: 0,
+         };
+         if (job.remaining === 0) {
+            summaries.push(summarize(path, sampleRate, sampleCount, job.result, 0));
+            continue;
+         }
+
+         currentJob = job;
+         for (let first = 0; first < chunks; first += SEGMENT_CHUNKS) {
+            const lastChunk = Math.min(chunks, first + SEGMENT_CHUNKS);
+            pendingRanges.push({ id: nextTaskId++, path, firstChunk: first, lastChunk, settings });
+         }
+      }
+      const task = pendingRanges.shift()!;
+      return { task, job: currentJob! };
+   };
+
+   const complete = ({ id, result, elapsedMs }: TaskResult) => {
+      const { job, firstChunk } = jobs.get(id)!;
+      jobs.delete(id);
+      job.result.frequencies.set(result.frequencies, firstChunk);
+      job.result.cents.set(result.cents, firstChunk);
+      job.result.noteIndices.set(result.noteIndices, firstChunk);
+      job.result.confidences.set(result.confidences, firstChunk);
+      job.processingMs += elapsedMs;
+      if (--job.remaining === 0) {
+         summaries.push(summarize(job.path, job.sampleRate, job.sampleCount, job.result, job.processingMs));
+         console.error(`  ${job.path}: ${summaries[summaries.length - 1].detections} detections`);
+      }
+   };
+
+   if (workerCount === 0) {
+      for (let next = nextTask(); next; next = nextTask()) {
+         jobs.set(next.task.id, { job: next.job, firstChunk: next.task.firstChunk });
+         complete(runTask(next.task));
+      }
+   } else {
+      await Promise.all(
+         Array.from({ length: workerCount }, async () => {
+            const worker = new Worker(new URL(import.meta.url));
+            try {
+               for (let next = nextTask(); next; next = nextTask()) {
+                  jobs.set(next.task.id, { job: next.job, firstChunk: next.task.firstChunk });
+                  const done = new Promise<TaskResult>((resolve, reject) => {
+                     worker.once("message", resolve);
+                     worker.once("error", reject);
+                  });
+                  worker.postMessage(next.task);
+                  const result = await done;
+                  worker.removeAllListeners("error");
+                  complete(result);
+               }
+            } finally {
+               await worker.terminate();
+            }
+         }),
+      );
+   }
+
+   return summaries.sort((a, b) => a.file.localeCompare(b.file));
+}
+
+const ENGINES: YinEngine[] = ["direct", "fft", "wasm"];
+
+function optionValue(args: string[], name: string): string | undefined {
+   const index = args.indexOf(name);
+   return index >= 0 ? args[index + 1] : undefined;
+}
+
+async function main() {
+   const args = process.argv.slice(2);
+   const valueOptions = ["--workers", "--json", "--csv", "--engine"];
+   const inputs = args.filter((arg, i) => !arg.startsWith("--") && !valueOptions.includes(args[i - 1]));
+
+   const engine = (optionValue(args, "--engine") ?? "direct") as YinEngine;
+   const unknownEngine = !ENGINES.includes(engine);
+   if (unknownEngine) {
+      console.error(`Unknown engine "${engine}"`);
+   }
+   if (inputs.length === 0 || unknownEngine) {
+      console.log("Usage: node batch-analyze.ts <dir|file|glob>... [options]");
+      console.log("Options:");
+      console.log("  --workers <n>     Worker threads, 0 analyses on the main thread (default: CPU count)");
+      console.log("  --json <file>     Write the summary as JSON (default: stdout when no --csv is given)");
+      console.log("  --csv <file>      Write the summary as CSV");
+      console.log("  --engine <name>   Difference function engine: direct, fft or wasm (default: direct)");
+      console.log("  --decimate        Coarse-to-fine search on a decimated signal");
+      console.log("Examples:");
+      console.log("  node batch-analyze.ts src/test/data --csv summary.csv");
+      console.log('  node batch-analyze.ts "takes/**/*.wav" --json summary.json --workers 8');
+      process.exit(1);
+   }
+
+   const files = expandInputs(inputs);
+   if (files.length === 0) {
+      console.error("No WAV files found");
+      process.exit(1);
+   }
+
+   const workerCount = Number(optionValue(args, "--workers") ?? os.availableParallelism());
+   const settings: DetectorSettings = {
+      threshold: 0.1,
+      fMin: 40.0,
+      engine,
+      earlyExit: true,
+      decimate: args.includes("--decimate"),
+   };
+
+   console.error(`Analysing ${files.length} files with ${workerCount} workers...`);
+   const start = performance.now();
+   const summaries = await runBatch(files, settings, workerCount);
+   const wallMs = performance.now() - start;
+
+   const audioSec = summaries.reduce((sum, summary) => sum + summary.durationSec, 0);
+   const totals = {
+      files: summaries.length,
+      audioSec,
+      chunks: summaries.reduce((sum, summary) => sum + summary.chunks, 0),
+      detections: summaries.reduce((sum, summary) => sum + summary.detections, 0),
+      wallMs,
+      realtimeFactor: audioSec / (wallMs / 1000),
+   };
+   console.error(
+      `Done: ${totals.files} files, ${audioSec.toFixed(1)}s of audio in ${(wallMs / 1000).toFixed(2)}s (${totals.realtimeFactor.toFixed(0)}x realtime)`,
+   );
+
+   const jsonPath = optionValue(args, "--json");
+   const csvPath = optionValue(args, "--csv");
+   const json = JSON.stringify({ settings, workers: workerCount, totals, files: summaries }, null, 2);
+   if (jsonPath) fs.writeFileSync(jsonPath, json);
+   if (csvPath) fs.writeFileSync(csvPath, toCsv(summaries));
+   if (!jsonPath && !csvPath) console.log(json);
+}
+
+if (isMainThread) {
+   await main();
+}
@@ -0,0 +1,90 @@
+import assert from "node:assert";
+import fs from "node:fs";
+import os from "node:os";
+import path from "node:path";
+import { test } from "node:test";
+import { fileURLToPath } from "node:url";
+import { encodeWav } from "../frontend/pcm-capture.js";
+import { analyzeRange, CHUNK_SIZE, expandInputs, type RangeResult, summarize } from "./batch.js";
+import { PcmFile } from "./wav.js";
+
+const DATA_DIR = path.join(path.dirname(fileURLToPath(import.meta.url)), "data");
+
+const SETTINGS = { threshold: 0.1, fMin: 40, earlyExit: true };
+
+// Analyses the file in segments and compares every chunk with a single pass
+function assertSegmentsMatch(pcm: PcmFile, label: string, segment: number): RangeResult {
+   const chunks = Math.floor(pcm.frames / CHUNK_SIZE);
+   const whole = analyzeRange(pcm, 0, chunks, SETTINGS);
+   for (let first = 0; first < chunks; first += segment) {
+      const last = Math.min(chunks, first + segment);
+      const part = analyzeRange(pcm, first, last, SETTINGS);
+      for (let i = 0; i < last - first; i++) {
+         const at = `${label} chunk ${first + i}`;
+         assert.strictEqual(part.noteIndices[i], whole.noteIndices[first + i], `${at}: note mismatch`);
+         assert.ok(
+            Object.is(part.frequencies[i], whole.frequencies[first + i]),
+            `${at}: ${part.frequencies[i]} != ${whole.frequencies[first + i]}`,
+         );
+      }
+   }
+   return whole;
+}
+
+test("Segmented analysis matches a single pass", () => {
+   for (const file of fs.readdirSync(DATA_DIR).filter((name) => name.endsWith(".wav"))) {
+      const pcm = new PcmFile(path.join(DATA_DIR, file));
+      const whole = assertSegmentsMatch(pcm, file, 20);
+      const summary = summarize(file, pcm.format.sampleRate, pcm.frames, whole, 0);
+      pcm.close();
+      assert.strictEqual(summary.chunks, Math.floor(pcm.frames / CHUNK_SIZE));
+      assert.ok(summary.detections > 0, `${file}: no detections`);
+   }
+});
+
+test("Segments starting in a long gap keep the previous note's history", () => {
+   // A2 for 10 chunks, 40 silent chunks, D3 for 20 chunks. The segment at chunk 40 starts in the gap,
+   // the serial run still smooths the first D3 detections with the A2 ones.
+   const sampleRate = 48000;
+   const samples = new Float32Array(70 * CHUNK_SIZE);
+   for (let i = 0; i < 10 * CHUNK_SIZE; i++) samples[i] = 0.5 * Math.sin((2 * Math.PI * 110 * i) / sampleRate);
+   for (let i = 50 * CHUNK_SIZE; i < samples.length; i++) {
+      samples[i] = 0.5 * Math.sin((2 * Math.PI * 146.83 * i) / sampleRate);
+   }
+
+   const dir = fs.mkdtempSync(path.join(os.tmpdir(), "tuner-batch-"));
+   const wavPath = path.join(dir, "gap.wav");
+   fs.writeFileSync(wavPath, new Uint8Array(encodeWav(samples, sampleRate)));
+   const pcm = new PcmFile(wavPath);
+   try {
+      const whole = assertSegmentsMatch(pcm, "gap.wav", 20);
+      assert.ok(Number.isNaN(whole.frequencies[30]), "gap detected");
+      assert.ok(whole.frequencies[50] < 140, `no history at the gap's end: ${whole.frequencies[50]}`);
+   } finally {
+      pcm.close();
+      fs.rmSync(dir, { recursive: true });
+   }
+});
+
+test("Inputs expand directories and glob patterns to WAV files", () => {
+   const root = fs.mkdtempSync(path.join(os.tmpdir(), "tuner-batch-"));
+   try {
+      for (const file of ["a.wav", "b.WAV", "notes.txt", "takes/c.wav", "takes/old/d.wav"]) {
+         fs.mkdirSync(path.dirname(path.join(root, file)), { recursive: true });
+         fs.writeFileSync(path.join(root, file), "");
+      }
+      const relative = (files: string[]) => files.map((file) => path.relative(root, file).split(path.sep).join("/"));
+
+      assert.deepStrictEqual(relative(expandInputs([root])), ["a.wav", "b.WAV", "takes/c.wav", "takes/old/d.wav"]);
+      assert.deepStrictEqual(relative(expandInputs([`${root}/*.wav`])), ["a.wav", "b.WAV"]);
+      assert.deepStrictEqual(relative(expandInputs([`${root}/**/*.wav`])), [
+         "a.wav",
+         "b.WAV",
+         "takes/c.wav",
+         "takes/old/d.wav",
+      ]);
+      assert.deepStrictEqual(relative(expandInputs([`${root}/takes/?.wav`, `${root}/a.wav`])), ["a.wav", "takes/c.wav"]);
+   } finally {
+      fs.rmSync(root, { recursive: true, force: true });
+   }
+});
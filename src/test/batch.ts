@@ -0,0 +1,202 @@
+import fs from "node:fs";
+import path from "node:path";
+import { NOTE_NAMES, PitchDetector, type PitchDetectorOptions } from "../pitch-detector.js";
+import type { PcmFile } from "./wav.js";
+
+// Shared pieces of the batch analysis tool (batch-analyze.ts), kept free of worker and CLI code
+// so the segment stitching can be tested on its own.
+
+export type DetectorSettings = Omit<PitchDetectorOptions, "sampleRate">;
+
+// Per-chunk detections of a range of chunks, NaN frequency and confidence where nothing was detected
+export interface RangeResult {
+   frequencies: Float64Array;
+   cents: Float64Array;
+   noteIndices: Int8Array;
+   confidences: Float32Array;
+}
+
+export interface FileSummary {
+   file: string;
+   sampleRate: number;
+   durationSec: number;
+   chunks: number;
+   detections: number;
+   detectionRate: number; // detected chunks / chunks
+   medianFrequency: number | null;
+   dominantNote: string | null;
+   dominantNoteShare: number; // share of detections with the dominant note
+   meanAbsCents: number | null;
+   meanConfidence: number | null; // 1 - CMNDF minimum, averaged over the detections
+   processingMs: number; // summed over all segments of the file
+}
+
+// Detections analysed ahead of a segment and thrown away, so the smoothing history at the segment
+// start matches a serial run. The history holds the last 4 detections, undetected chunks leave it
+// untouched however long a gap lasts.
+export const WARMUP_DETECTIONS = 4;
+
+// The detector's fixed frame size, independent of the sample rate
+export const CHUNK_SIZE = new PitchDetector({ sampleRate: 48000 }).chunkSize;
+
+// Analyses chunks [firstChunk, lastChunk) of a file with a fresh detector. Chunks are read one at a
+// time with pread, the file is never loaded as a whole.
+export function analyzeRange(
+   file: PcmFile,
+   firstChunk: number,
+   lastChunk: number,
+   settings: DetectorSettings,
+): RangeResult {
+   const detector = new PitchDetector({ ...settings, sampleRate: file.format.sampleRate, reuseResult: true });
+   const samples = new Float32Array(CHUNK_SIZE);
+   const count = lastChunk - firstChunk;
+   const result: RangeResult = {
+      frequencies: new Float64Array(count).fill(Number.NaN),
+      cents: new Float64Array(count).fill(Number.NaN),
+      noteIndices: new Int8Array(count).fill(-1),
+      confidences: new Float32Array(count).fill(Number.NaN),
+   };
+
+   for (let chunk = warmupStart(file, firstChunk, settings, samples); chunk < lastChunk; chunk++) {
+      file.read(chunk * CHUNK_SIZE, samples);
+      const detection = detector.processAudioChunk(samples);
+      if (!detection || chunk < firstChunk) continue;
+      const i = chunk - firstChunk;
+      result.frequencies[i] = detection.frequency;
+      result.cents[i] = detection.cents;
+      result.noteIndices[i] = NOTE_NAMES.indexOf(detection.note);
+      result.confidences[i] = detection.confidence;
+   }
+   return result;
+}
+
+// Walks back from firstChunk to the WARMUP_DETECTIONS-th detection before it, or to the file start.
+// Whether a chunk is detected does not depend on the history, so a fresh detector finds them.
+function warmupStart(file: PcmFile, firstChunk: number, settings: DetectorSettings, samples: Float32Array): number {
+   const probe = new PitchDetector({ ...settings, sampleRate: file.format.sampleRate, reuseResult: true });
+   let detections = 0;
+   for (let chunk = firstChunk - 1; chunk >= 0; chunk--) {
+      file.read(chunk * CHUNK_SIZE, samples);
+      if (probe.processAudioChunk(samples) && ++detections === WARMUP_DETECTIONS) return chunk;
+   }
+   return 0;
+}
+
+export function summarize(
+   file: string,
+   sampleRate: number,
+   sampleCount: number,
+   result: RangeResult,
+   processingMs: number,
+): FileSummary {
+   const chunks = result.frequencies.length;
+   const frequencies: number[] = [];
+   const noteCounts = new Array<number>(NOTE_NAMES.length).fill(0);
+   let absCents = 0;
+   let confidence = 0;
+   for (let i = 0; i < chunks; i++) {
+      if (Number.isNaN(result.frequencies[i])) continue;
+      frequencies.push(result.frequencies[i]);
+      noteCounts[result.noteIndices[i]]++;
+      absCents += Math.abs(result.cents[i]);
+      confidence += result.confidences[i];
+   }
+
+   const detections = frequencies.length;
+   frequencies.sort((a, b) => a - b);
+   let dominant = -1;
+   for (let note = 0; note < noteCounts.length; note++) {
+      if (noteCounts[note] > 0 && (dominant < 0 || noteCounts[note] > noteCounts[dominant])) dominant = note;
+   }
+
+   return {
+      file,
+      sampleRate,
+      durationSec: sampleCount / sampleRate,
+      chunks,
+      detections,
+      detectionRate: chunks > 0 ? detections / chunks : 0,
+      medianFrequency: detections > 0 ? frequencies[Math.floor(detections / 2)] : null,
+      dominantNote: dominant >= 0 ? NOTE_NAMES[dominant] : null,
+      dominantNoteShare: dominant >= 0 ? noteCounts[dominant] / detections : 0,
+      meanAbsCents: detections > 0 ? absCents / detections : null,
+      meanConfidence: detections > 0 ? confidence / detections : null,
+      processingMs,
+   };
+}
+
+export function toCsv(summaries: FileSummary[]): string {
+   const columns: Array<keyof FileSummary> = [
+      "file",
+      "sampleRate",
+      "durationSec",
+      "chunks",
+      "detections",
+      "detectionRate",
+      "medianFrequency",
+      "dominantNote",
+      "dominantNoteShare",
+      "meanAbsCents",
+      "meanConfidence",
+      "processingMs",
+   ];
+   const escape = (value: unknown) => {
+      const text = value === null ? "" : typeof value === "number" ? String(Number(value.toFixed(4))) : String(value);
+      return /[",\n]/.test(text) ? `"${text.replace(/"/g, '""')}"` : text;
+   };
+   const rows = summaries.map((summary) => columns.map((column) => escape(summary[column])).join(","));
+   return `${[columns.join(","), ...rows].join("\n")}\n`;
+}
+
+// Expands directories (recursively) and glob patterns (*, ** and ?) into a sorted list of .wav files
+export function expandInputs(inputs: string[]): string[] {
+   const files = new Set<string>();
+   for (const input of inputs) {
+      if (/[*?]/.test(input)) {
+         // Walk from the last directory before the first wildcard
+         const parts = input.split(/[\\/]/);
+         const firstWildcard = parts.findIndex((part) => /[*?]/.test(part));
+         const root = parts.slice(0, firstWildcard).join(path.sep) || ".";
+         const pattern = globToRegExp(parts.slice(firstWildcard).join("/"));
+         for (const file of walk(root)) {
+            if (pattern.test(path.relative(root, file).split(path.sep).join("/"))) files.add(file);
+         }
+      } else if (fs.statSync(input).isDirectory()) {
+         for (const file of walk(input)) {
+            if (file.toLowerCase().endsWith(".wav")) files.add(file);
+         }
+      } else {
+         files.add(input);
+      }
+   }
+   return [...files].sort();
+}
+
+function globToRegExp(glob: string): RegExp {
+   let source = "";
+   for (let i = 0; i < glob.length; i++) {
+      const c = glob[i];
+      if (c === "*" && glob[i + 1] === "*") {
+         // "**/" matches any number of directories, including none
+         source += glob[i + 2] === "/" ? "(?:.*/)?" : ".*";
+         i += glob[i + 2] === "/" ? 2 : 1;
+      } else if (c === "*") {
+         source += "[^/]*";
+      } else if (c === "?") {
+         source += "[^/]";
+      } else {
+         source += c.replace(/[.+^${}()|[\]\\]/g, "\\$&");
+      }
+   }
+   return new RegExp(`^${source}$`, "i");
+}
+
+function walk(dir: string): string[] {
+   const files: string[] = [];
+   for (const entry of fs.readdirSync(dir, { withFileTypes: true })) {
+      const full = path.join(dir, entry.name);
+      if (entry.isDirectory()) files.push(...walk(full));
+      else if (entry.isFile()) files.push(full);
+   }
+   return files;
+}
@@ -0,0 +1,60 @@
+import { PitchDetector, type YinEngine } from "../pitch-detector.js";
+import { WasmYinKernel } from "../wasm-yin.js";
+
+// Compares the YIN engines on full 2048 sample chunks at the usual capture rates.
+// fMin 40Hz, so maxTau (and the cost of the direct loop) grows with the sample rate.
+
+const SAMPLE_RATES = [44100, 48000, 96000];
+const ENGINES: YinEngine[] = ["direct", "wasm", "fft"];
+const WARMUP_MS = 300;
+const MEASURE_MS = 1000;
+
+// Low E with harmonics. Every engine computes the whole difference function,
+// so the signal only affects the threshold search.
+function harmonicSignal(frequency: number, sampleRate: number, length: number): Float32Array {
+   const signal = new Float32Array(length);
+   for (let i = 0; i < length; i++) {
+      for (let h = 1; h <= 6; h++) {
+         signal[i] += (0.5 * Math.sin((2 * Math.PI * frequency * h * i) / sampleRate)) / h;
+      }
+   }
+   return signal;
+}
+
+function run(detector: PitchDetector, chunk: Float32Array, durationMs: number): number {
+   let chunks = 0;
+   const start = performance.now();
+   let elapsed = 0;
+   while (elapsed < durationMs) {
+      for (let i = 0; i < 10; i++) detector.processAudioChunk(chunk);
+      chunks += 10;
+      elapsed = performance.now() - start;
+   }
+   return elapsed / chunks;
+}
+
+if (!WasmYinKernel.isSupported()) {
+   console.log("WebAssembly SIMD not supported, the wasm engine runs the scalar fallback");
+}
+
+const rows: Array<Record<string, string>> = [];
+for (const sampleRate of SAMPLE_RATES) {
+   const timings: Partial<Record<YinEngine, number>> = {};
+   for (const engine of ENGINES) {
+      const detector = new PitchDetector({ sampleRate, engine, reuseResult: true });
+      const chunk = harmonicSignal(82.41, sampleRate, detector.chunkSize);
+      run(detector, chunk, WARMUP_MS);
+      timings[engine] = run(detector, chunk, MEASURE_MS);
+   }
+
+   const direct = timings.direct!;
+   const row: Record<string, string> = { sampleRate: `${sampleRate}Hz`, maxTau: `${Math.floor(sampleRate / 40)}` };
+   for (const engine of ENGINES) {
+      const ms = timings[engine]!;
+      row[engine] = `${ms.toFixed(3)}ms (${(direct / ms).toFixed(1)}x)`;
+   }
+   rows.push(row);
+}
+
+console.log("Time per 2048 sample chunk, speedup relative to the scalar direct loop:");
+console.table(rows);
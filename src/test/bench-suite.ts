@@ -0,0 +1,347 @@
+import os from "node:os";
+import { PerformanceObserver } from "node:perf_hooks";
+import v8 from "node:v8";
+import vm from "node:vm";
+import { isMainThread, parentPort, Worker, workerData } from "node:worker_threads";
+import { LIVE_OCTAVE_CORRECTION, LIVE_OUTLIER_FILTER, WORKLET_ENGINE } from "../frontend/live-pipeline.js";
+import { PitchDetector, type PitchDetectorOptions } from "../pitch-detector.js";
+
+// Microbenchmark suite for PitchDetector.processAudioChunk over sample rates, fMin, signal types
+// and detector configurations. Every chunk is timed on its own, so results have percentiles
+// rather than a single average, and garbage collections during the measured chunks are counted.
+// Each case runs in a fresh worker thread, its own V8 isolate, so JIT feedback and heap state of
+// earlier cases can not leak into it and a filtered run measures the same as a full one.
+// Run through bench.ts (npm run bench).
+
+// Same trick as allocation.test.ts, a forced collection before each case keeps earlier cases'
+// garbage out of its GC count
+v8.setFlagsFromString("--expose-gc");
+const gc = vm.runInNewContext("gc") as () => void;
+
+const SAMPLE_RATES = [44100, 48000, 96000];
+const F_MINS = [40, 80];
+const SIGNALS = ["sine", "harmonic", "noise", "silence"] as const;
+type SignalType = (typeof SIGNALS)[number];
+
+// The plain detector and the options the AudioWorklet runs with, taken from the live pipeline
+// so the gate measures every stage the tuner runs
+const CONFIGS: Record<string, Omit<PitchDetectorOptions, "sampleRate" | "fMin">> = {
+   default: {},
+   worklet: { ...WORKLET_ENGINE, outlierFilter: LIVE_OUTLIER_FILTER, octaveCorrection: LIVE_OCTAVE_CORRECTION },
+};
+
+// Distinct consecutive chunks cycled through, so tracking and smoothing see a continuous signal
+const SIGNAL_CHUNKS = 32;
+
+// Warm-up runs for at least warmupMs and at least this many chunks, slow configurations need the
+// chunk count to reach optimized code
+const WARMUP_CHUNKS = 300;
+
+export interface BenchResult {
+   name: string;
+   config: string;
+   sampleRate: number;
+   fMin: number;
+   signal: SignalType;
+   iterations: number;
+   meanNs: number;
+   minNs: number;
+   p50Ns: number;
+   p99Ns: number;
+   chunksPerSec: number;
+   detections: number; // chunks with a detected pitch
+   gcCount: number; // collections during the measured chunks
+   gcMs: number;
+   bytesPerChunk: number; // heap and array buffer growth, before any collection
+   calibrationNs: number; // p50 of the reference workload, see Calibration
+}
+
+export interface BenchReport {
+   meta: {
+      date: string;
+      node: string;
+      v8: string;
+      platform: string;
+      arch: string;
+      cpu: string;
+   };
+   results: BenchResult[];
+}
+
+// Cases measured by the regression gate (npm run perf) and recorded in bench-baseline.json
+export const GATE_FILTER = "worklet/48k,default/48k/fMin40";
+
+// Regressions beyond the tolerance, as relative growth: 0.5 allows 50% more time per chunk
+export const DEFAULT_TOLERANCE = 0.5;
+
+// Noise floor of the allocation figures: optimizing compilations still running after the warm-up
+// allocate on the heap and can trigger a few scavenges. allocation.test.ts is the strict check,
+// this catches what it would not, such as a new frame sized array per chunk (8KB+).
+const ALLOCATION_SLACK_BYTES = 4096;
+const GC_SLACK = 3;
+
+// Deterministic noise, so runs stay comparable
+function xorshift(seed: number): () => number {
+   let state = seed;
+   return () => {
+      state ^= state << 13;
+      state ^= state >>> 17;
+      state ^= state << 5;
+      return (state >>> 0) / 4294967296;
+   };
+}
+
+function generateSignal(type: SignalType, sampleRate: number, length: number): Float32Array {
+   const signal = new Float32Array(length);
+   const random = xorshift(0x2545f491);
+   const frequency = 110; // A2
+   for (let i = 0; i < length; i++) {
+      const phase = (2 * Math.PI * frequency * i) / sampleRate;
+      switch (type) {
+         case "sine":
+            signal[i] = 0.5 * Math.sin(phase);
+            break;
+         case "harmonic":
+            for (let h = 1; h <= 8; h++) signal[i] += (0.5 * Math.sin(h * phase)) / h;
+            break;
+         case "noise":
+            signal[i] = 0.5 * (random() * 2 - 1);
+            break;
+         case "silence":
+            break;
+      }
+   }
+   return signal;
+}
+
+function percentile(sorted: Float64Array, q: number): number {
+   return sorted[Math.min(sorted.length - 1, Math.max(0, Math.ceil(q * sorted.length) - 1))];
+}
+
+interface BenchCase {
+   config: string;
+   sampleRate: number;
+   fMin: number;
+   signal: SignalType;
+   warmupMs: number;
+   iterations: number;
+}
+
+// Fixed reference workload: a scalar difference function over part of a frame, independent of
+// the detector code. It is timed interleaved with the case, every CALIBRATION_INTERVAL chunks,
+// so both see the same machine state. Comparisons with a baseline use case timings relative to
+// it, which takes the machine's speed and most of its current load out of the picture.
+const CALIBRATION_INTERVAL = 4;
+
+class Calibration {
+   private readonly frame = generateSignal("noise", 48000, 2048);
+   private readonly diff = new Float64Array(256);
+
+   step() {
+      const { frame, diff } = this;
+      for (let tau = 1; tau < diff.length; tau++) {
+         let sum = 0;
+         for (let i = 0; i < frame.length - diff.length; i++) {
+            const delta = frame[i] - frame[i + tau];
+            sum += delta * delta;
+         }
+         diff[tau] = sum;
+      }
+   }
+}
+
+// The timed loop. Warm-up runs this same code, so it is already optimized when measured and
+// its own compilation does not end up in the allocation count.
+class TimedRun {
+   readonly timings: Float64Array;
+   readonly calibrationTimings: Float64Array;
+   private readonly detector: PitchDetector;
+   private readonly chunks: Float32Array[];
+   private readonly calibration = new Calibration();
+   private next = 0;
+
+   constructor(detector: PitchDetector, chunks: Float32Array[], iterations: number) {
+      this.detector = detector;
+      this.chunks = chunks;
+      this.timings = new Float64Array(iterations);
+      this.calibrationTimings = new Float64Array(Math.ceil(iterations / CALIBRATION_INTERVAL));
+   }
+
+   // Times iterations chunks, returns the number of detections
+   run(): number {
+      const { detector, chunks, calibration, timings, calibrationTimings } = this;
+      let detections = 0;
+      for (let i = 0; i < timings.length; i++) {
+         const input = chunks[this.next++ % chunks.length];
+         // performance.now() rather than hrtime.bigint(), BigInts would show up in the allocation count
+         const start = performance.now();
+         const result = detector.processAudioChunk(input);
+         timings[i] = (performance.now() - start) * 1e6;
+         if (result) detections++;
+
+         if (i % CALIBRATION_INTERVAL === 0) {
+            const calibrationStart = performance.now();
+            calibration.step();
+            calibrationTimings[i / CALIBRATION_INTERVAL] = (performance.now() - calibrationStart) * 1e6;
+         }
+      }
+      return detections;
+   }
+}
+
+async function runCase({ config, sampleRate, fMin, signal, warmupMs, iterations }: BenchCase): Promise<BenchResult> {
+   const detector = new PitchDetector({ ...CONFIGS[config], sampleRate, fMin, reuseResult: true });
+   const source = generateSignal(signal, sampleRate, detector.chunkSize * SIGNAL_CHUNKS);
+   const chunks = Array.from({ length: SIGNAL_CHUNKS }, (_, i) =>
+      source.subarray(i * detector.chunkSize, (i + 1) * detector.chunkSize),
+   );
+   const warmup = new TimedRun(detector, chunks, Math.min(iterations, 50));
+   const measured = new TimedRun(detector, chunks, iterations);
+
+   const warmupEnd = performance.now() + warmupMs;
+   for (let warmed = 0; warmed < WARMUP_CHUNKS || performance.now() < warmupEnd; warmed += warmup.timings.length) {
+      warmup.run();
+   }
+
+   const gcs: Array<{ start: number; duration: number }> = [];
+   const observer = new PerformanceObserver((list) => {
+      for (const entry of list.getEntries()) gcs.push({ start: entry.startTime, duration: entry.duration });
+   });
+   observer.observe({ entryTypes: ["gc"] });
+   gc();
+
+   const before = process.memoryUsage();
+   const startTime = performance.now();
+   const detections = measured.run();
+   const endTime = performance.now();
+   const after = process.memoryUsage();
+
+   // GC entries are delivered asynchronously, on a later timer tick
+   await new Promise((resolve) => setTimeout(resolve, 50));
+   observer.disconnect();
+   const measuredGcs = gcs.filter((entry) => entry.start >= startTime && entry.start <= endTime);
+
+   const timings = measured.timings.sort();
+   const total = timings.reduce((sum, ns) => sum + ns, 0);
+   return {
+      name: `${config}/${sampleRate / 1000}k/fMin${fMin}/${signal}`,
+      config,
+      sampleRate,
+      fMin,
+      signal,
+      iterations,
+      meanNs: total / iterations,
+      minNs: timings[0],
+      p50Ns: percentile(timings, 0.5),
+      p99Ns: percentile(timings, 0.99),
+      chunksPerSec: 1e9 / (total / iterations),
+      detections,
+      gcCount: measuredGcs.length,
+      gcMs: measuredGcs.reduce((sum, entry) => sum + entry.duration, 0),
+      bytesPerChunk: Math.max(
+         0,
+         (after.heapUsed - before.heapUsed + (after.arrayBuffers - before.arrayBuffers)) / iterations,
+      ),
+      calibrationNs: percentile(measured.calibrationTimings.sort(), 0.5),
+   };
+}
+
+function runInWorker(benchCase: BenchCase): Promise<BenchResult> {
+   return new Promise((resolve, reject) => {
+      const worker = new Worker(new URL(import.meta.url), { workerData: benchCase });
+      worker.once("message", resolve);
+      worker.once("error", reject);
+   });
+}
+
+if (!isMainThread && workerData?.iterations) {
+   parentPort!.postMessage(await runCase(workerData as BenchCase));
+}
+
+// filter: comma separated substrings of case names, e.g. "worklet/48k,default/96k/fMin40/sine"
+export async function runBenchmarks(options: {
+   filter?: string;
+   warmupMs?: number;
+   iterations?: number;
+   log?: (result: BenchResult) => void;
+}): Promise<BenchReport> {
+   const { filter, warmupMs = 200, iterations = 500, log } = options;
+   const filters = filter ? filter.split(",").filter(Boolean) : [];
+   const results: BenchResult[] = [];
+   for (const config of Object.keys(CONFIGS)) {
+      for (const sampleRate of SAMPLE_RATES) {
+         for (const fMin of F_MINS) {
+            for (const signal of SIGNALS) {
+               const name = `${config}/${sampleRate / 1000}k/fMin${fMin}/${signal}`;
+               if (filters.length > 0 && !filters.some((part) => name.includes(part))) continue;
+               const result = await runInWorker({ config, sampleRate, fMin, signal, warmupMs, iterations });
+               results.push(result);
+               log?.(result);
+            }
+         }
+      }
+   }
+
+   return {
+      meta: {
+         date: new Date().toISOString(),
+         node: process.version,
+         v8: process.versions.v8,
+         platform: process.platform,
+         arch: process.arch,
+         cpu: os.cpus()[0]?.model ?? "unknown",
+      },
+      results,
+   };
+}
+
+// Combines several runs of the same cases into one report, keeping per case the run with the
+// median p50 relative to the calibration workload
+export function combineRuns(reports: BenchReport[]): BenchReport {
+   const runs = new Map<string, BenchResult[]>();
+   for (const report of reports) {
+      for (const result of report.results) {
+         const list = runs.get(result.name) ?? [];
+         list.push(result);
+         runs.set(result.name, list);
+      }
+   }
+   const results = [...runs.values()].map((list) => {
+      list.sort((a, b) => relativeTime(a) - relativeTime(b));
+      return list[(list.length - 1) >> 1];
+   });
+   return { meta: reports[reports.length - 1].meta, results };
+}
+
+export function relativeTime(result: BenchResult): number {
+   return result.p50Ns / result.calibrationNs;
+}
+
+// Describes every case that regressed against the baseline: p50 time per chunk relative to the
+// calibration workload, or allocated bytes and GCs per run. Cases missing on either side are skipped.
+export function findRegressions(report: BenchReport, baseline: BenchReport, tolerance = DEFAULT_TOLERANCE): string[] {
+   const baselineResults = new Map(baseline.results.map((result) => [result.name, result]));
+   const regressions: string[] = [];
+   for (const result of report.results) {
+      const base = baselineResults.get(result.name);
+      if (!base) continue;
+
+      const relative = relativeTime(result);
+      const baseRelative = relativeTime(base);
+      if (relative > baseRelative * (1 + tolerance)) {
+         const change = ((relative / baseRelative - 1) * 100).toFixed(0);
+         regressions.push(`${result.name}: p50 +${change}% relative to the calibration workload`);
+      }
+
+      const byteLimit = base.bytesPerChunk * (1 + tolerance) + ALLOCATION_SLACK_BYTES;
+      if (result.bytesPerChunk > byteLimit) {
+         regressions.push(
+            `${result.name}: ${result.bytesPerChunk.toFixed(0)} B/chunk allocated, baseline ${base.bytesPerChunk.toFixed(0)}`,
+         );
+      }
+      if (result.gcCount > Math.ceil(base.gcCount * (1 + tolerance)) + GC_SLACK) {
+         regressions.push(`${result.name}: ${result.gcCount} GCs during the run, baseline ${base.gcCount}`);
+      }
+   }
+   return regressions;
+}
@@ -0,0 +1,95 @@
+import fs from "node:fs";
+import {
+   type BenchReport,
+   combineRuns,
+   DEFAULT_TOLERANCE,
+   findRegressions,
+   GATE_FILTER,
+   relativeTime,
+   runBenchmarks,
+} from "./bench-suite.js";
+
+// npm run bench: runs the microbenchmark suite, prints a table and writes the results as JSON.
+// Pass a previous results file with --compare to see the change per case, or with --check to
+// fail on regressions, which is how npm run perf gates against the committed baseline. Update
+// the baseline after intended changes with:
+// npm run bench -- --gate --repeat 3 --json src/test/bench-baseline.json
+
+function optionValue(args: string[], name: string): string | undefined {
+   const index = args.indexOf(name);
+   return index >= 0 ? args[index + 1] : undefined;
+}
+
+function formatNs(ns: number): string {
+   return ns >= 1e6 ? `${(ns / 1e6).toFixed(2)}ms` : `${(ns / 1e3).toFixed(1)}µs`;
+}
+
+async function main() {
+   const args = process.argv.slice(2);
+   if (args.includes("--help")) {
+      console.log("Usage: npm run bench -- [options]");
+      console.log("Options:");
+      console.log("  --filter <list>      Only cases whose name contains one of the comma separated texts");
+      console.log(`  --gate               Only the regression gate's cases (${GATE_FILTER})`);
+      console.log("  --iterations <n>     Measured chunks per case (default: 500)");
+      console.log("  --warmup <ms>        Warm-up time per case (default: 200)");
+      console.log("  --repeat <n>         Run the cases n times and keep the median run of each (default: 1)");
+      console.log("  --json <file>        Results file (default: bench-results.json)");
+      console.log("  --compare <file>     Previous results to compare p50 against");
+      console.log("  --check <file>       Exit with an error if a case regressed against these results");
+      console.log(`  --tolerance <x>      Allowed relative regression for --check (default: ${DEFAULT_TOLERANCE})`);
+      process.exit(0);
+   }
+
+   const jsonPath = optionValue(args, "--json") ?? "bench-results.json";
+   const comparePath = optionValue(args, "--compare");
+   const previous = comparePath
+      ? new Map((JSON.parse(fs.readFileSync(comparePath, "utf8")) as BenchReport).results.map((r) => [r.name, r]))
+      : null;
+
+   const runs: BenchReport[] = [];
+   const repeat = Number(optionValue(args, "--repeat") ?? 1);
+   for (let run = 0; run < repeat; run++) {
+      runs.push(
+         await runBenchmarks({
+            filter: args.includes("--gate") ? GATE_FILTER : optionValue(args, "--filter"),
+            warmupMs: Number(optionValue(args, "--warmup") ?? 200),
+            iterations: Number(optionValue(args, "--iterations") ?? 500),
+            log: (result) => console.error(`  ${result.name}: p50 ${formatNs(result.p50Ns)}, p99 ${formatNs(result.p99Ns)}`),
+         }),
+      );
+   }
+   const report = combineRuns(runs);
+
+   const rows = report.results.map((result) => {
+      const row: Record<string, string | number> = {
+         case: result.name,
+         p50: formatNs(result.p50Ns),
+         p99: formatNs(result.p99Ns),
+         "p50/cal": relativeTime(result).toFixed(3),
+         "chunks/s": Math.round(result.chunksPerSec),
+         detected: `${Math.round((100 * result.detections) / result.iterations)}%`,
+         gc: result.gcCount,
+         "B/chunk": Math.round(result.bytesPerChunk),
+      };
+      const before = previous?.get(result.name);
+      if (before) row["p50 Δ"] = `${(((result.p50Ns - before.p50Ns) / before.p50Ns) * 100).toFixed(1)}%`;
+      return row;
+   });
+
+   console.table(rows);
+   fs.writeFileSync(jsonPath, `${JSON.stringify(report, null, 2)}\n`);
+   console.log(`Results written to ${jsonPath}`);
+
+   const checkPath = optionValue(args, "--check");
+   if (checkPath) {
+      const baseline = JSON.parse(fs.readFileSync(checkPath, "utf8")) as BenchReport;
+      const tolerance = Number(optionValue(args, "--tolerance") ?? DEFAULT_TOLERANCE);
+      const regressions = findRegressions(report, baseline, tolerance);
+      for (const regression of regressions) console.error(`Regression: ${regression}`);
+      if (regressions.length > 0) process.exit(1);
+      console.log(`No regressions against ${checkPath}`);
+   }
+}
+
+await main();
@@ -0,0 +1,34 @@
+import assert from "node:assert";
+import { test } from "node:test";
+import { DebugRecording, decodeDebugSession } from "../frontend/debug-recording.js";
+
+test("Debug recording keeps the newest detections once full", () => {
+   const recording = new DebugRecording(8);
+   for (let i = 0; i < 5; i++) recording.push(i * 10, 100 + i, "A", i);
+   assert.strictEqual(recording.length, 5);
+   assert.strictEqual(recording.overwritten, 0);
+
+   let session = decodeDebugSession(recording.encode({ a4Frequency: 440 }));
+   assert.deepStrictEqual(Array.from(session.timestamps), [0, 10, 20, 30, 40]);
+
+   for (let i = 5; i < 13; i++) recording.push(i * 10, 100 + i, i % 2 === 0 ? "E" : "", i);
+   assert.strictEqual(recording.length, 8);
+   assert.strictEqual(recording.overwritten, 5);
+   assert.strictEqual(recording.lastTimestamp, 120);
+
+   session = decodeDebugSession(recording.encode({ a4Frequency: 440, note: "ä" }));
+   assert.deepStrictEqual(session.metadata, { a4Frequency: 440, note: "ä" });
+   assert.deepStrictEqual(Array.from(session.timestamps), [50, 60, 70, 80, 90, 100, 110, 120]);
+   assert.deepStrictEqual(Array.from(session.frequencies), [105, 106, 107, 108, 109, 110, 111, 112]);
+   assert.deepStrictEqual(Array.from(session.cents), [5, 6, 7, 8, 9, 10, 11, 12]);
+   // E is note 4, detections without a note name are stored as 255
+   assert.deepStrictEqual(Array.from(session.notes), [255, 4, 255, 4, 255, 4, 255, 4]);
+
+   recording.clear();
+   assert.strictEqual(recording.length, 0);
+   assert.strictEqual(decodeDebugSession(recording.encode({})).timestamps.length, 0);
+});
+
+test("Debug session decoding rejects other data", () => {
+   assert.throws(() => decodeDebugSession(new TextEncoder().encode('{"recordings":[]}').buffer), /Not a tuner/);
+});
@@ -1,6 +1,6 @@
 import assert from "node:assert";
 import { test } from "node:test";
-import { PitchDetector } from "../pitch-detector.js";
+import { PitchDetector, type YinEngine } from "../pitch-detector.js";
 
 const SAMPLE_RATE = 48000;
 
@@ -17,14 +17,7 @@ export function generateTestSignal(frequency: number, sampleRate: number, durati
    return signal;
 }
 
-async function testYINImplementation() {
-   const detector = new PitchDetector({
-      sampleRate: SAMPLE_RATE,
-      debug: false,
-      threshold: 0.1,
-      fMin: 40.0,
-   });
-
+async function testYINImplementation(engine: YinEngine = "direct") {
    const testCases = [
       { freq: 82.41, expectedNote: "E" },
       { freq: 110.0, expectedNote: "A" },
@@ -38,6 +31,14 @@ async function testYINImplementation() {
    const durations: number[] = [];
 
    for (const testCase of testCases) {
+      // Fresh detector per case so the smoothing history of the previous note does not leak in
+      const detector = new PitchDetector({
+         sampleRate: SAMPLE_RATE,
+         debug: false,
+         threshold: 0.1,
+         fMin: 40.0,
+         engine,
+      });
       const signal = generateTestSignal(testCase.freq, SAMPLE_RATE, 0.1); // 100ms signal
 
       let result = null;
@@ -110,18 +111,12 @@ test("YIN pitch detection accuracy", async () => {
    console.log(
       `  Real-time capable: ${isRealTime ? "✅" : "❌"} (${(avgDuration * 1000).toFixed(1)}ms < ${(realTimeLimit * 1000).toFixed(1)}ms)`,
    );
+   assert.ok(isRealTime, `${(avgDuration * 1000).toFixed(1)}ms per chunk is slower than real time`);
 });
 
 test("YIN frequency range support", async () => {
    console.log("Testing YIN frequency range support...");
 
-   const detector = new PitchDetector({
-      sampleRate: SAMPLE_RATE,
-      debug: false,
-      threshold: 0.1,
-      fMin: 40.0,
-   });
-
    const testCases = [
       { freq: 41.2, expectedNote: "E", description: "Low E (baritone)" },
       { freq: 82.41, expectedNote: "E", description: "Standard low E" },
@@ -132,6 +127,12 @@ test("YIN frequency range support", async () => {
    let passed = 0;
 
    for (const testCase of testCases) {
+      const detector = new PitchDetector({
+         sampleRate: SAMPLE_RATE,
+         debug: false,
+         threshold: 0.1,
+         fMin: 40.0,
+      });
       const signal = generateTestSignal(testCase.freq, SAMPLE_RATE, 0.1);
 
       let result = null;
@@ -169,3 +170,252 @@ test("YIN frequency range support", async () => {
    // Should support most of the range
    assert.ok(passed >= testCases.length * 0.7, `Only ${passed}/${testCases.length} range tests passed`);
 });
+
+for (const engine of ["fft", "wasm"] as YinEngine[]) {
+   test(`${engine.toUpperCase()} engine matches direct difference function`, async () => {
+      console.log(`Testing ${engine} engine against direct engine...`);
+
+      const signals: Array<{ description: string; signal: Float32Array }> = [];
+      for (const freq of [41.2, 82.41, 110.0, 196.0, 329.63, 659.25]) {
+         signals.push({ description: `${freq}Hz sine`, signal: generateTestSignal(freq, SAMPLE_RATE, 0.1) });
+      }
+
+      // Harmonic-rich signal, closer to a plucked string than a pure sine
+      const harmonic = new Float32Array(4096);
+      for (let i = 0; i < harmonic.length; i++) {
+         for (let h = 1; h <= 8; h++) {
+            harmonic[i] += Math.sin((2 * Math.PI * 110 * h * i) / SAMPLE_RATE) / h;
+         }
+      }
+      signals.push({ description: "110Hz harmonic-rich", signal: harmonic });
+
+      for (const sampleRate of [44100, 48000, 96000]) {
+         for (const { description, signal } of signals) {
+            const direct = new PitchDetector({ sampleRate, engine: "direct" });
+            const other = new PitchDetector({ sampleRate, engine });
+            const chunk = signal.subarray(0, direct.chunkSize);
+
+            const expected = direct.processAudioChunk(chunk);
+            const actual = other.processAudioChunk(chunk);
+
+            assert.strictEqual(actual === null, expected === null, `${description} @ ${sampleRate}Hz: detection mismatch`);
+            if (expected && actual) {
+               assert.ok(
+                  Math.abs(actual.frequency - expected.frequency) < 0.01,
+                  `${description} @ ${sampleRate}Hz: ${engine} ${actual.frequency} != direct ${expected.frequency}`,
+               );
+               assert.strictEqual(actual.note, expected.note);
+            }
+         }
+      }
+
+      const { passed, total } = await testYINImplementation(engine);
+      assert.ok(passed >= total * 0.8, `${engine} engine: only ${passed}/${total} tests passed`);
+   });
+}
+
+test("A4 reference change rebuilds the note table", async () => {
+   const detector = new PitchDetector({ sampleRate: SAMPLE_RATE, a4Frequency: 440 });
+   const chunk = generateTestSignal(440, SAMPLE_RATE, 0.1).subarray(0, detector.chunkSize);
+
+   const at440 = detector.processAudioChunk(chunk);
+   assert.ok(at440 && at440.note === "A" && Math.abs(at440.cents) < 1, "440Hz should read as an in-tune A");
+
+   // 440Hz against A4 = 432Hz is about +31.8 cents sharp
+   detector.setA4Frequency(432);
+   detector.reset();
+   const at432 = detector.processAudioChunk(chunk);
+   assert.ok(at432 && at432.note === "A" && Math.abs(at432.cents - 31.8) < 1, `Expected +31.8 cents, got ${at432?.cents}`);
+});
+
+test("Streaming pushSamples matches per-window analysis", async () => {
+   console.log("Testing overlapping hop-size streaming...");
+
+   // Gliding harmonic tone that fades into silence, so windows both detect and reject
+   const length = Math.floor(SAMPLE_RATE * 0.5);
+   const signal = new Float32Array(length);
+   let phase = 0;
+   for (let i = 0; i < length; i++) {
+      const frequency = 100 + (30 * i) / length;
+      phase += (2 * Math.PI * frequency) / SAMPLE_RATE;
+      const envelope = i < length * 0.7 ? 1 : 0;
+      signal[i] = envelope * (Math.sin(phase) + 0.5 * Math.sin(2 * phase) + 0.25 * Math.sin(3 * phase));
+   }
+
+   for (const { engine, hopSize } of [
+      { engine: "direct" as YinEngine, hopSize: 256 },
+      { engine: "direct" as YinEngine, hopSize: 512 },
+      { engine: "fft" as YinEngine, hopSize: 128 },
+   ]) {
+      const streaming = new PitchDetector({ sampleRate: SAMPLE_RATE, engine, hopSize });
+      const reference = new PitchDetector({ sampleRate: SAMPLE_RATE, engine });
+      const n = streaming.chunkSize;
+
+      // Window k covers samples [k * hopSize, k * hopSize + chunkSize)
+      const expected: Array<number | null> = [];
+      for (let start = 0; start + n <= length; start += hopSize) {
+         expected.push(reference.processAudioChunk(signal.subarray(start, start + n))?.frequency ?? null);
+      }
+
+      // Feed render-quantum sized blocks like the AudioWorklet does. Every hop size here is a
+      // multiple of 128, so each analysis completes at the end of exactly one block.
+      const actual: Array<number | null> = [];
+      let pushed = 0;
+      for (let start = 0; start + 128 <= length; start += 128) {
+         const result = streaming.pushSamples(signal.subarray(start, start + 128));
+         pushed += 128;
+         if (pushed >= n && (pushed - n) % hopSize === 0) {
+            actual.push(result?.frequency ?? null);
+         }
+      }
+      // The last window may not end on a block boundary
+      assert.ok(expected.length - actual.length <= 1, `${engine}/${hopSize}: ${actual.length} analyses`);
+      expected.length = actual.length;
+
+      const detected = expected.filter((f) => f !== null).length;
+      assert.ok(detected > expected.length / 2, `${engine}/${hopSize}: only ${detected}/${expected.length} detections`);
+      for (let i = 0; i < expected.length; i++) {
+         const e = expected[i];
+         const a = actual[i];
+         assert.strictEqual(a === null, e === null, `${engine}/${hopSize}: window ${i} detection mismatch`);
+         if (e !== null && a !== null) {
+            assert.ok(Math.abs(a - e) < 0.01, `${engine}/${hopSize}: window ${i} ${a}Hz != ${e}Hz`);
+         }
+      }
+      console.log(`  ✅ ${engine}, hop ${hopSize}: ${expected.length} windows, ${detected} detections`);
+   }
+});
+
+test("Adaptive window tracks a stable pitch and widens when it is lost", async () => {
+   console.log("Testing adaptive window...");
+
+   for (const freq of [82.41, 146.83, 246.94, 329.63]) {
+      const adaptive = new PitchDetector({ sampleRate: SAMPLE_RATE, adaptiveWindow: true });
+      const signal = generateTestSignal(freq, SAMPLE_RATE, 0.5);
+
+      let result = null;
+      for (let start = 0; start + adaptive.chunkSize <= signal.length; start += adaptive.chunkSize) {
+         result = adaptive.processAudioChunk(signal.subarray(start, start + adaptive.chunkSize));
+      }
+      assert.ok(result && Math.abs(result.frequency - freq) < 0.5, `${freq}Hz tracked as ${result?.frequency}Hz`);
+      console.log(`  ✅ ${freq}Hz → ${result.frequency.toFixed(2)}Hz`);
+   }
+
+   // Tracking a high E, then switching to a low E outside the shrunken tau range
+   const detector = new PitchDetector({ sampleRate: SAMPLE_RATE, adaptiveWindow: true });
+   const high = generateTestSignal(329.63, SAMPLE_RATE, 0.3);
+   const low = generateTestSignal(82.41, SAMPLE_RATE, 0.5);
+   const n = detector.chunkSize;
+   for (let start = 0; start + n <= high.length; start += n) {
+      detector.processAudioChunk(high.subarray(start, start + n));
+   }
+
+   let lowResult = null;
+   for (let start = 0; start + n <= low.length; start += n) {
+      lowResult = detector.processAudioChunk(low.subarray(start, start + n));
+   }
+   assert.ok(lowResult && lowResult.note === "E" && Math.abs(lowResult.frequency - 82.41) < 0.5, "Did not recover low E");
+   console.log(`  ✅ 329.63Hz → 82.41Hz switch recovered: ${lowResult.frequency.toFixed(2)}Hz`);
+});
+
+test("Early exit matches the full tau search", async () => {
+   console.log("Testing early exit YIN...");
+
+   const frequencies = [41.2, 82.41, 110.0, 196.0, 329.63, 659.25];
+   const signals = frequencies.map((freq) => generateTestSignal(freq, SAMPLE_RATE, 0.1));
+   const noise = new Float32Array(4096);
+   for (let i = 0; i < noise.length; i++) noise[i] = Math.random() * 2 - 1;
+   signals.push(noise, new Float32Array(4096));
+
+   for (const signal of signals) {
+      const full = new PitchDetector({ sampleRate: SAMPLE_RATE });
+      const early = new PitchDetector({ sampleRate: SAMPLE_RATE, earlyExit: true });
+      const chunk = signal.subarray(0, full.chunkSize);
+      const expected = full.processAudioChunk(chunk);
+      const actual = early.processAudioChunk(chunk);
+      assert.strictEqual(actual?.frequency, expected?.frequency);
+   }
+
+   // A tau window around A2 (110Hz) skips the 220Hz octave the unrestricted search would pick
+   const octave = generateTestSignal(220, SAMPLE_RATE, 0.1);
+   const restricted = new PitchDetector({
+      sampleRate: SAMPLE_RATE,
+      earlyExit: true,
+      tauRange: [SAMPLE_RATE / 150, SAMPLE_RATE / 80],
+   });
+   const result = restricted.processAudioChunk(octave.subarray(0, restricted.chunkSize));
+   assert.ok(result && Math.abs(result.frequency - 110) < 1, `Expected 110Hz, got ${result?.frequency}`);
+});
+
+test("Decimated search matches the full rate search", async () => {
+   console.log("Testing decimation front end...");
+
+   for (const sampleRate of [44100, 48000, 96000]) {
+      for (const freq of [41.2, 82.41, 110.0, 146.83, 196.0, 246.94, 329.63, 659.25, 790.0]) {
+         // Harmonic-rich, so the anti-aliasing filter has something to remove
+         const signal = new Float32Array(2048);
+         for (let i = 0; i < signal.length; i++) {
+            for (let h = 1; h <= 8; h++) {
+               signal[i] += Math.sin((2 * Math.PI * freq * h * i) / sampleRate) / h;
+            }
+         }
+
+         const full = new PitchDetector({ sampleRate }).processAudioChunk(signal);
+         // Periods longer than the window (41.2Hz at 96kHz) are out of reach for both
+         if (!full || Math.abs(full.frequency - freq) > freq * 0.01) continue;
+
+         const decimated = new PitchDetector({ sampleRate, decimate: true }).processAudioChunk(signal);
+         assert.ok(decimated, `${freq}Hz @ ${sampleRate}Hz: no decimated detection`);
+         assert.ok(
+            Math.abs(decimated.frequency - full.frequency) < 0.001,
+            `${freq}Hz @ ${sampleRate}Hz: decimated ${decimated.frequency} != full ${full.frequency}`,
+         );
+      }
+   }
+
+   // 8kHz input has nothing to decimate, the detector runs at full rate
+   const lowRate = new PitchDetector({ sampleRate: 8000, decimate: true });
+   const result = lowRate.processAudioChunk(generateTestSignal(220, 8000, 0.3).subarray(0, lowRate.chunkSize));
+   assert.ok(result && Math.abs(result.frequency - 220) < 1);
+});
+
+test("Detections report raw frequency, confidence and level", async () => {
+   for (const options of [{}, { earlyExit: true }, { decimate: true }, { engine: "wasm" as const }]) {
+      const detector = new PitchDetector({ sampleRate: SAMPLE_RATE, ...options });
+      const tone = generateTestSignal(196, SAMPLE_RATE, 0.2);
+      const chunk = new Float32Array(detector.chunkSize);
+      for (let i = 0; i < chunk.length; i++) chunk[i] = 0.5 * tone[i];
+
+      const clean = detector.processAudioChunk(chunk);
+      const label = JSON.stringify(options);
+      assert.ok(clean, `${label}: no detection`);
+      assert.ok(Math.abs(clean.rawFrequency - 196) < 0.5, `${label}: raw ${clean.rawFrequency}`);
+      assert.ok(clean.confidence > 0.95 && clean.confidence <= 1, `${label}: confidence ${clean.confidence}`);
+      assert.ok(Math.abs(clean.windowRms - 0.5 / Math.SQRT2) < 0.01, `${label}: level ${clean.windowRms}`);
+
+      // Deterministic noise makes the frame less periodic
+      let seed = 1;
+      for (let i = 0; i < chunk.length; i++) {
+         seed = (seed * 1103515245 + 12345) % 2147483648;
+         chunk[i] = 0.5 * tone[i] + 0.1 * (seed / 1073741824 - 1);
+      }
+      const noisy = detector.processAudioChunk(chunk);
+      assert.ok(noisy, `${label}: no detection with noise`);
+      assert.ok(noisy.confidence < clean.confidence, `${label}: ${noisy.confidence} >= ${clean.confidence}`);
+      assert.ok(noisy.confidence >= 0.9, `${label}: detections stay within the threshold`);
+   }
+});
+
+test("Level covers only the analysed window while a pitch is tracked", () => {
+   const detector = new PitchDetector({ sampleRate: SAMPLE_RATE, adaptiveWindow: true });
+   const tone = generateTestSignal(196, SAMPLE_RATE, 0.2);
+   const chunk = new Float32Array(detector.chunkSize);
+   for (let i = 0; i < chunk.length; i++) chunk[i] = 0.5 * tone[i];
+   for (let i = 0; i < 4; i++) detector.processAudioChunk(chunk);
+
+   // The window is a few periods at the end of the frame, silence before it does not lower the level
+   chunk.fill(0, 0, chunk.length / 2);
+   const result = detector.processAudioChunk(chunk);
+   assert.ok(result, "no detection");
+   assert.ok(Math.abs(result.windowRms - 0.5 / Math.SQRT2) < 0.01, `level ${result.windowRms}`);
+});
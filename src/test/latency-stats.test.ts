@@ -0,0 +1,63 @@
+import assert from "node:assert";
+import { test } from "node:test";
+import { CallbackTimer, LATENCY_BUCKETS_MS, LatencyHistogram } from "../latency-stats.js";
+import { PitchDetector } from "../pitch-detector.js";
+
+test("Latency histogram buckets and percentiles", () => {
+   const histogram = new LatencyHistogram();
+   for (let i = 0; i < 98; i++) histogram.record(0.3);
+   histogram.record(3);
+   histogram.record(300);
+
+   const snapshot = histogram.snapshot();
+   assert.strictEqual(snapshot.count, 100);
+   assert.strictEqual(snapshot.p50Ms, 0.5);
+   assert.strictEqual(snapshot.p99Ms, 4);
+   assert.strictEqual(snapshot.maxMs, 300);
+   assert.strictEqual(histogram.percentile(100), 300);
+   assert.strictEqual(snapshot.buckets.length, LATENCY_BUCKETS_MS.length + 1);
+   assert.strictEqual(snapshot.buckets[snapshot.buckets.length - 1], 1);
+   assert.ok(Math.abs(snapshot.meanMs - (98 * 0.3 + 303) / 100) < 1e-9);
+
+   histogram.reset();
+   assert.strictEqual(histogram.snapshot().count, 0);
+   assert.strictEqual(histogram.percentile(50), 0);
+});
+
+test("Callback timer measures jitter against the audio clock", () => {
+   // 128 frame quanta at 48kHz, rendered in bursts of four per device buffer
+   const timer = new CallbackTimer(48000, 40);
+   const quantumMs = (128 * 1000) / 48000;
+   for (let buffer = 0; buffer < 100; buffer++) {
+      const bufferTime = 1000 + buffer * 4 * quantumMs;
+      for (let i = 0; i < 4; i++) timer.tick(bufferTime + i * 0.01, 128);
+   }
+   assert.strictEqual(timer.late, 0);
+   // The first quantum of a burst runs early, the last one three quanta late
+   assert.ok(timer.jitter.maxMs > 3 * quantumMs - 0.1 && timer.jitter.maxMs < 3 * quantumMs + 0.1);
+
+   // A 100ms stall counts once, later callbacks are measured against the new reference
+   const stalled = 1000 + 400 * quantumMs + 100;
+   for (let i = 0; i < 10; i++) timer.tick(stalled + i * quantumMs, 128);
+   assert.strictEqual(timer.late, 1);
+});
+
+test("Detector counts analyses and detections", () => {
+   const sampleRate = 48000;
+   const detector = new PitchDetector({ sampleRate, fMin: 80 });
+   const sine = new Float32Array(detector.chunkSize);
+   for (let i = 0; i < sine.length; i++) sine[i] = Math.sin((2 * Math.PI * 220 * i) / sampleRate);
+   const silence = new Float32Array(detector.chunkSize);
+
+   for (let i = 0; i < 5; i++) detector.processAudioChunk(sine);
+   for (let i = 0; i < 3; i++) detector.processAudioChunk(silence);
+
+   const stats = detector.stats();
+   assert.strictEqual(stats.analyses, 8);
+   assert.strictEqual(stats.detections, 5);
+   assert.strictEqual(stats.computeTime.count, 8);
+   assert.ok(stats.computeTime.maxMs > 0);
+
+   detector.resetStats();
+   assert.strictEqual(detector.stats().analyses, 0);
+});
@@ -0,0 +1,67 @@
+import assert from "node:assert";
+import { test } from "node:test";
+import { NeedleSpring } from "../frontend/needle-spring.js";
+
+function settle(frameMs: number, durationMs: number): number[] {
+   const spring = new NeedleSpring();
+   spring.update(1000);
+   spring.setTarget(20, 1000, false);
+   const positions: number[] = [];
+   for (let time = 1000 + frameMs; time <= 1000 + durationMs + 1e-9; time += frameMs) {
+      positions.push(spring.update(time));
+   }
+   return positions;
+}
+
+test("Needle settles on a step without overshoot at any refresh rate", () => {
+   const at60 = settle(1000 / 60, 500);
+   const at120 = settle(1000 / 120, 500);
+
+   for (let i = 1; i < at120.length; i++) {
+      assert.ok(at120[i] >= at120[i - 1] && at120[i] <= 20, `frame ${i}: ${at120[i]}`);
+   }
+   assert.ok(Math.abs(at60[at60.length - 1] - 20) < 0.01, `${at60[at60.length - 1]}`);
+   // The step is solved exactly, so the position only depends on time, not on the frame rate
+   assert.ok(Math.abs(at60[14] - at120[29]) < 1e-9, `${at60[14]} != ${at120[29]}`);
+});
+
+test("Needle extrapolates a glide between detections", () => {
+   const rate = 100; // cents per second
+   const frameMs = 1000 / 120;
+   const detectionMs = 43;
+   const gliding = new NeedleSpring();
+   const holding = new NeedleSpring();
+
+   let glidingError = 0;
+   let holdingError = 0;
+   let nextDetection = 0;
+   for (let time = 0; time < 1000; time += frameMs) {
+      while (nextDetection <= time) {
+         const cents = -45 + (rate * nextDetection) / 1000;
+         gliding.setTarget(cents, nextDetection + 1, true);
+         holding.setTarget(cents, nextDetection + 1, false);
+         nextDetection += detectionMs;
+      }
+      const truth = -45 + (rate * time) / 1000;
+      const g = gliding.update(time + 1);
+      const h = holding.update(time + 1);
+      // Past the spring's initial catch up and before the glide reaches the end of the scale
+      if (time > 400 && time < 900) {
+         glidingError = Math.max(glidingError, Math.abs(g - truth));
+         holdingError = Math.max(holdingError, Math.abs(h - truth));
+      }
+   }
+   // Without the rate of change the needle trails a steady glide by 2 * rate / omega cents
+   assert.ok(holdingError > 5, `holding ${holdingError}`);
+   assert.ok(glidingError < 1, `gliding ${glidingError}`);
+});
+
+test("Note change drops the rate of change", () => {
+   const spring = new NeedleSpring();
+   spring.setTarget(0, 100, false);
+   spring.setTarget(10, 150, true);
+   spring.setTarget(-30, 200, false);
+   let cents = 0;
+   for (let time = 200; time <= 1200; time += 10) cents = spring.update(time);
+   assert.ok(Math.abs(cents + 30) < 0.01, `${cents}`);
+});
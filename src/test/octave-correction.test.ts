@@ -0,0 +1,101 @@
+import assert from "node:assert";
+import { test } from "node:test";
+import { PitchDetector } from "../pitch-detector.js";
+
+const SAMPLE_RATE = 48000;
+
+// Continuous signal of a fundamental and its second harmonic, one chunk per call
+function source(detector: PitchDetector) {
+   const chunk = new Float32Array(detector.chunkSize);
+   let position = 0;
+   return (frequency: number, fundamental: number, harmonic: number) => {
+      for (let i = 0; i < chunk.length; i++) {
+         const phase = (2 * Math.PI * frequency * (position + i)) / SAMPLE_RATE;
+         chunk[i] = fundamental * Math.sin(phase) + harmonic * Math.sin(2 * phase);
+      }
+      position += chunk.length;
+      return detector.processAudioChunk(chunk)?.frequency ?? null;
+   };
+}
+
+test("Octave correction keeps the fundamental through a strong second harmonic", () => {
+   for (const engine of ["direct", "wasm"] as const) {
+      const plain = source(new PitchDetector({ sampleRate: SAMPLE_RATE, engine }));
+      const corrected = source(new PitchDetector({ sampleRate: SAMPLE_RATE, engine, octaveCorrection: true }));
+      for (let i = 0; i < 4; i++) {
+         plain(110, 1, 0.3);
+         corrected(110, 1, 0.3);
+      }
+
+      // An attack where the second harmonic dominates, plain YIN picks 220Hz
+      for (let i = 0; i < 2; i++) {
+         const plainFrequency = plain(110, 0.15, 1);
+         const correctedFrequency = corrected(110, 0.15, 1);
+         assert.ok(plainFrequency !== null && plainFrequency > 130, `${engine}: plain ${plainFrequency}`);
+         assert.ok(
+            correctedFrequency !== null && Math.abs(correctedFrequency - 110) < 0.5,
+            `${engine}: corrected ${correctedFrequency}`,
+         );
+      }
+   }
+});
+
+test("Octave correction lets a sustained octave change through", () => {
+   const next = source(new PitchDetector({ sampleRate: SAMPLE_RATE, octaveCorrection: true }));
+   for (let i = 0; i < 4; i++) next(110, 1, 0.3);
+
+   // A pure 220Hz tone is periodic at 110Hz too, it is held for a few analyses only
+   let frequency: number | null = null;
+   for (let i = 0; i < 8; i++) frequency = next(220, 1, 0);
+   assert.ok(frequency !== null && Math.abs(frequency - 220) < 0.5, `${frequency}`);
+});
+
+test("Octave correction forgets the history after a silence", () => {
+   const plain = source(new PitchDetector({ sampleRate: SAMPLE_RATE }));
+   const corrected = source(new PitchDetector({ sampleRate: SAMPLE_RATE, octaveCorrection: true }));
+   for (let i = 0; i < 4; i++) {
+      plain(110, 1, 0.3);
+      corrected(110, 1, 0.3);
+   }
+   for (let i = 0; i < 16; i++) {
+      plain(110, 0, 0);
+      assert.strictEqual(corrected(110, 0, 0), null);
+   }
+
+   // Without a recent history there is nothing to correct towards, the picks stand
+   for (let i = 0; i < 4; i++) {
+      assert.strictEqual(corrected(220, 1, 0), plain(220, 1, 0));
+   }
+});
+
+test("Octave correction holds through an attack at the worklet hop", () => {
+   const hopSize = 512;
+   const hops = (ms: number) => Math.round((ms * SAMPLE_RATE) / 1000 / hopSize);
+   const detectors = [false, true].map(
+      (octaveCorrection) => new PitchDetector({ sampleRate: SAMPLE_RATE, hopSize, octaveCorrection }),
+   );
+   const hop = new Float32Array(hopSize);
+   let position = 0;
+   // Frequencies of the plain and the corrected detector for the next hop
+   const next = (fundamental: number, harmonic: number) => {
+      for (let i = 0; i < hop.length; i++) {
+         const phase = (2 * Math.PI * 110 * (position + i)) / SAMPLE_RATE;
+         hop[i] = fundamental * Math.sin(phase) + harmonic * Math.sin(2 * phase);
+      }
+      position += hopSize;
+      return detectors.map((detector) => detector.pushSamples(hop)?.frequency ?? null);
+   };
+
+   for (let i = 0; i < hops(200); i++) next(1, 0.3);
+   // An 80ms attack where the second harmonic dominates. Windows mixing both parts detect nothing,
+   // the others are more analyses than 3 chunks would be.
+   let detections = 0;
+   for (let i = 0; i < hops(80); i++) {
+      const [plain, corrected] = next(0.15, 1);
+      if (corrected === null) continue;
+      detections++;
+      assert.ok(plain !== null && plain > 130, `hop ${i}: plain ${plain}`);
+      assert.ok(Math.abs(corrected - 110) < 0.5, `hop ${i}: corrected ${corrected}`);
+   }
+   assert.ok(detections > 3, `${detections} detections`);
+});
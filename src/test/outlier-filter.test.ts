@@ -0,0 +1,81 @@
+import assert from "node:assert";
+import { test } from "node:test";
+import { OUTLIER_STRATEGIES, OutlierFilter } from "../outlier-filter.js";
+import { PitchDetector } from "../pitch-detector.js";
+
+// Worklet hop at 48kHz
+const HOP_MS = (512 * 1000) / 48000;
+
+function accepted(filter: OutlierFilter, frequencies: number[]): boolean[] {
+   return frequencies.map((frequency) => filter.accept(frequency));
+}
+
+test("Every strategy keeps a steady note and rejects a pluck transient", () => {
+   for (const strategy of OUTLIER_STRATEGIES) {
+      const filter = new OutlierFilter(strategy, HOP_MS);
+      const steady = [110, 110.2, 109.9, 110.1, 110, 110.1, 109.9, 110];
+      assert.deepStrictEqual(accepted(filter, steady), steady.map(() => true), `${strategy}: steady note`);
+      // An octave error for one reading
+      assert.strictEqual(filter.accept(220), strategy === "none", `${strategy}: octave spike`);
+      // Rate change and hybrid compare with the previous detection, the jump back is rejected too
+      const comparesPrevious = strategy === "rate-change" || strategy === "hybrid";
+      assert.strictEqual(filter.accept(110), !comparesPrevious, `${strategy}: back on the note`);
+      assert.strictEqual(filter.accept(110.1), true, `${strategy}: steady again`);
+   }
+});
+
+test("Filters follow a new note once it persists", () => {
+   for (const strategy of OUTLIER_STRATEGIES) {
+      const filter = new OutlierFilter(strategy, HOP_MS);
+      accepted(filter, new Array(20).fill(110));
+      // A to B for 200ms, close enough for the regime filter's change range. Confirming it takes the
+      // 3 readings of the offline filters' interval, about 140ms.
+      const next = accepted(filter, new Array(Math.round(200 / HOP_MS)).fill(123.5));
+      const confirmed = Math.round((3 * 46.4) / HOP_MS);
+      assert.ok(next.slice(confirmed - 1).every((keep) => keep), `${strategy}: ${next}`);
+   }
+});
+
+test("Confirmation spans the same time at the worklet hop", () => {
+   for (const strategy of ["transient", "moving-window", "adaptive-regime"] as const) {
+      const filter = new OutlierFilter(strategy, HOP_MS);
+      accepted(filter, new Array(20).fill(110));
+      // A transient that agrees with itself for 64ms is still no new note
+      const transient = accepted(filter, new Array(Math.round(64 / HOP_MS)).fill(123.5));
+      assert.ok(transient.every((keep) => !keep), `${strategy}: ${transient}`);
+      assert.strictEqual(filter.accept(110), true, `${strategy}: back on the note`);
+   }
+});
+
+test("Transient filter allows realistic tuning speed", () => {
+   const filter = new OutlierFilter("transient", HOP_MS);
+   // Tuning up by a semitone per second, well below the filter's limit
+   for (let time = 0; time < 1000; time += HOP_MS) {
+      assert.ok(filter.accept(110 * 2 ** (time / 1000 / 12)), `rejected at ${time.toFixed(0)}ms`);
+   }
+});
+
+test("A silence starts afresh", () => {
+   const filter = new OutlierFilter("transient", HOP_MS);
+   accepted(filter, [110, 110, 110]);
+   for (let i = 0; i < 30; i++) filter.miss();
+   // The next string's first reading
+   assert.strictEqual(filter.accept(147), true);
+});
+
+test("Detector drops outliers before smoothing", () => {
+   const sampleRate = 48000;
+   const detector = new PitchDetector({ sampleRate, outlierFilter: "transient" });
+   const chunk = new Float32Array(detector.chunkSize);
+   const render = (frequency: number) => {
+      for (let i = 0; i < chunk.length; i++) chunk[i] = Math.sin((2 * Math.PI * frequency * i) / sampleRate);
+      return detector.processAudioChunk(chunk);
+   };
+
+   for (let i = 0; i < 4; i++) render(196);
+   assert.strictEqual(render(392), null);
+   assert.strictEqual(detector.outliers, 1);
+   const result = render(196);
+   assert.ok(result && Math.abs(result.frequency - 196) < 1, `${result?.frequency}`);
+   assert.strictEqual(detector.stats().outliers, 1);
+});
@@ -0,0 +1,103 @@
+import assert from "node:assert";
+import fs from "node:fs";
+import os from "node:os";
+import path from "node:path";
+import { test } from "node:test";
+import { encodeWav, PcmCapture } from "../frontend/pcm-capture.js";
+import { NOTE_NAMES, PitchDetector } from "../pitch-detector.js";
+import { analyzeRange, CHUNK_SIZE } from "./batch.js";
+import { PcmFile } from "./wav.js";
+
+test("Capture ring keeps the newest samples in order", () => {
+   const capture = new PcmCapture(10);
+   capture.push(Float32Array.from([0, 1, 2, 3]));
+   assert.deepStrictEqual(Array.from(capture.copy()), [0, 1, 2, 3]);
+   assert.strictEqual(capture.startFrame, 0);
+
+   capture.push(Float32Array.from([4, 5, 6, 7]));
+   capture.push(Float32Array.from([8, 9, 10, 11]));
+   assert.deepStrictEqual(Array.from(capture.copy()), [2, 3, 4, 5, 6, 7, 8, 9, 10, 11]);
+   assert.strictEqual(capture.startFrame, 2);
+
+   // Inputs larger than the ring only keep their end
+   capture.push(Float32Array.from({ length: 13 }, (_, i) => 12 + i));
+   assert.deepStrictEqual(Array.from(capture.copy()), [15, 16, 17, 18, 19, 20, 21, 22, 23, 24]);
+   assert.strictEqual(capture.startFrame, 15);
+});
+
+test("Handed over rings add up to the same capture", () => {
+   const capacity = 10;
+   const plain = new PcmCapture(capacity);
+   const audio = new PcmCapture(capacity);
+   const main = new PcmCapture(capacity);
+   let next = 0;
+   const push = (length: number) => {
+      const block = Float32Array.from({ length }, () => next++);
+      plain.push(block);
+      audio.push(block);
+   };
+   let empty = new Float32Array(capacity);
+   const handOver = () => {
+      const ring = audio.take(empty);
+      main.append(ring);
+      empty = ring.samples;
+   };
+
+   push(4);
+   handOver();
+   push(3);
+   push(4);
+   handOver();
+   assert.deepStrictEqual(Array.from(main.copy()), Array.from(plain.copy()));
+   assert.strictEqual(main.startFrame, plain.startFrame);
+
+   // The audio side overflowed since the last hand over, only its own samples connect
+   push(25);
+   handOver();
+   assert.deepStrictEqual(Array.from(main.copy()), [26, 27, 28, 29, 30, 31, 32, 33, 34, 35]);
+   assert.strictEqual(main.startFrame, 26);
+   assert.throws(() => audio.take(new Float32Array(capacity + 1)));
+});
+
+test("Captured WAV replays bit-exactly through the batch tool", () => {
+   const sampleRate = 48000;
+   const capture = new PcmCapture(CHUNK_SIZE * 8);
+   // Render quanta of a plucked A2 with a little noise, more than the ring holds
+   let seed = 1;
+   for (let quantum = 0; quantum < 200; quantum++) {
+      const block = new Float32Array(128);
+      for (let i = 0; i < block.length; i++) {
+         const t = (quantum * 128 + i) / sampleRate;
+         seed = (seed * 1103515245 + 12345) >>> 0;
+         block[i] = 0.5 * Math.sin(2 * Math.PI * 110 * t) * Math.exp(-t) + (seed / 2 ** 32 - 0.5) * 1e-3;
+      }
+      capture.push(block);
+   }
+   const samples = capture.copy();
+
+   const file = path.join(fs.mkdtempSync(path.join(os.tmpdir(), "tuner-capture-")), "capture.wav");
+   try {
+      fs.writeFileSync(file, new Uint8Array(encodeWav(samples, sampleRate)));
+      const pcm = new PcmFile(file);
+      assert.deepStrictEqual(pcm.format, { format: 3, channels: 1, sampleRate, bitDepth: 32 });
+      assert.strictEqual(pcm.frames, samples.length);
+      const read = new Float32Array(samples.length);
+      pcm.read(0, read);
+      assert.deepStrictEqual(read, samples);
+
+      const settings = { threshold: 0.1, fMin: 40 };
+      const chunks = samples.length / CHUNK_SIZE;
+      const replay = analyzeRange(pcm, 0, chunks, settings);
+      pcm.close();
+
+      const detector = new PitchDetector({ ...settings, sampleRate });
+      for (let chunk = 0; chunk < chunks; chunk++) {
+         const detection = detector.processAudioChunk(samples.subarray(chunk * CHUNK_SIZE, (chunk + 1) * CHUNK_SIZE));
+         assert.ok(detection, `chunk ${chunk}: no detection`);
+         assert.ok(Object.is(replay.frequencies[chunk], detection.frequency), `chunk ${chunk}`);
+         assert.strictEqual(NOTE_NAMES[replay.noteIndices[chunk]], detection.note);
+      }
+   } finally {
+      fs.rmSync(path.dirname(file), { recursive: true, force: true });
+   }
+});
@@ -0,0 +1,40 @@
+import assert from "node:assert";
+import { test } from "node:test";
+import { type BenchReport, type BenchResult, findRegressions } from "./bench-suite.js";
+
+// The regression check of the performance gate. The gate itself measures wall-clock time, which
+// is too noisy on a shared machine for npm test, and runs on demand against the committed baseline:
+//    npm run perf
+// After an intended change, regenerate the baseline with
+//    npm run bench -- --gate --repeat 3 --json src/test/bench-baseline.json
+
+test("Regression check flags doubled time and new allocations", () => {
+   const result: BenchResult = {
+      name: "worklet/48k/fMin40/sine",
+      config: "worklet",
+      sampleRate: 48000,
+      fMin: 40,
+      signal: "sine",
+      iterations: 500,
+      meanNs: 300000,
+      minNs: 250000,
+      p50Ns: 300000,
+      p99Ns: 400000,
+      chunksPerSec: 3333,
+      detections: 500,
+      gcCount: 0,
+      gcMs: 0,
+      bytesPerChunk: 200,
+      calibrationNs: 1000000,
+   };
+   const meta = { date: "", node: "", v8: "", platform: "", arch: "", cpu: "" };
+   const baseline: BenchReport = { meta, results: [result] };
+   const report = (changes: Partial<BenchResult>): BenchReport => ({ meta, results: [{ ...result, ...changes }] });
+
+   assert.deepStrictEqual(findRegressions(report({ p50Ns: 400000 }), baseline), []);
+   assert.strictEqual(findRegressions(report({ p50Ns: 600000 }), baseline).length, 1);
+   // A machine half as fast doubles both the case and the calibration workload
+   assert.deepStrictEqual(findRegressions(report({ p50Ns: 600000, calibrationNs: 2000000 }), baseline), []);
+   assert.strictEqual(findRegressions(report({ bytesPerChunk: 8 * 2048 }), baseline).length, 1);
+   assert.strictEqual(findRegressions(report({ gcCount: 5 }), baseline).length, 1);
+});
@@ -0,0 +1,48 @@
+import assert from "node:assert";
+import fs from "node:fs";
+import path from "node:path";
+import { test } from "node:test";
+import { fileURLToPath } from "node:url";
+import { PitchDetector } from "../pitch-detector.js";
+import { readWav } from "./wav.js";
+
+const DATA_DIR = path.join(path.dirname(fileURLToPath(import.meta.url)), "data");
+const recordings = fs.readdirSync(DATA_DIR).filter((file) => file.endsWith(".wav"));
+
+for (const file of recordings) {
+   test(`Coarse-to-fine search matches the full search on ${file}`, () => {
+      const { samples, sampleRate } = readWav(path.join(DATA_DIR, file));
+      const full = new PitchDetector({ sampleRate });
+      const coarseToFine = new PitchDetector({ sampleRate, decimate: true });
+
+      let fullTime = 0;
+      let coarseToFineTime = 0;
+      let detections = 0;
+      for (let offset = 0; offset + full.chunkSize <= samples.length; offset += full.chunkSize) {
+         const chunk = samples.subarray(offset, offset + full.chunkSize);
+
+         let start = performance.now();
+         const expected = full.processAudioChunk(chunk);
+         fullTime += performance.now() - start;
+
+         start = performance.now();
+         const actual = coarseToFine.processAudioChunk(chunk);
+         coarseToFineTime += performance.now() - start;
+
+         const at = `${file} @ ${(offset / sampleRate).toFixed(2)}s`;
+         assert.strictEqual(actual === null, expected === null, `${at}: detection mismatch`);
+         if (expected && actual) {
+            assert.ok(
+               Math.abs(actual.frequency - expected.frequency) < 0.001,
+               `${at}: coarse-to-fine ${actual.frequency} != full ${expected.frequency}`,
+            );
+            detections++;
+         }
+      }
+
+      console.log(
+         `  ${file}: ${detections} detections, full ${fullTime.toFixed(0)}ms, coarse-to-fine ${coarseToFineTime.toFixed(0)}ms`,
+      );
+      assert.ok(detections > 0, `${file}: no detections`);
+   });
+}
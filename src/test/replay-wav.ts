@@ -0,0 +1,50 @@
+import fs from "node:fs";
+import type { OutlierStrategy } from "../outlier-filter.js";
+import { type ReplayPath, replay, traceToCsv } from "./replay.js";
+import { PcmFile } from "./wav.js";
+
+// Replays a WAV file, e.g. a capture exported by the tuner's debug session, through the live
+// pipeline and prints the summary. The per-analysis trace goes to a CSV file for diffing or plotting.
+
+function optionValue(args: string[], name: string): string | undefined {
+   const index = args.indexOf(name);
+   return index >= 0 ? args[index + 1] : undefined;
+}
+
+function main() {
+   const args = process.argv.slice(2);
+   const valueOptions = ["--path", "--refresh", "--start-frame", "--filter", "--csv"];
+   const inputs = args.filter((arg, i) => !arg.startsWith("--") && !valueOptions.includes(args[i - 1]));
+
+   if (inputs.length !== 1) {
+      console.log("Usage: node replay-wav.ts <file.wav> [options]");
+      console.log("Options:");
+      console.log("  --path <name>       Detection path: worklet or script-processor (default: worklet)");
+      console.log("  --refresh <hz>      Display refresh rate (default: 60)");
+      console.log("  --start-frame <n>   Index of the file's first sample in the live input (default: 0)");
+      console.log("  --filter <name>     Outlier filter: none, transient, moving-window, rate-change,");
+      console.log("                      adaptive-regime or hybrid (default: transient, like the tuner)");
+      console.log("  --csv <file>        Write the per-analysis trace as CSV");
+      console.log("Examples:");
+      console.log("  node replay-wav.ts capture.wav --start-frame 96000 --csv trace.csv");
+      console.log("  node replay-wav.ts src/test/data/e.wav --path script-processor --refresh 120");
+      process.exit(1);
+   }
+
+   const file = new PcmFile(inputs[0]);
+   try {
+      const { trace, summary } = replay(file, {
+         path: (optionValue(args, "--path") as ReplayPath | undefined) ?? "worklet",
+         refreshRate: Number(optionValue(args, "--refresh") ?? 60),
+         startFrame: Number(optionValue(args, "--start-frame") ?? 0),
+         outlierFilter: optionValue(args, "--filter") as OutlierStrategy | undefined,
+      });
+      const csvPath = optionValue(args, "--csv");
+      if (csvPath) fs.writeFileSync(csvPath, traceToCsv(trace));
+      console.log(JSON.stringify(summary, null, 2));
+   } finally {
+      file.close();
+   }
+}
+
+main();
@@ -0,0 +1,93 @@
+import assert from "node:assert";
+import fs from "node:fs";
+import os from "node:os";
+import path from "node:path";
+import { test } from "node:test";
+import { fileURLToPath } from "node:url";
+import {
+   LIVE_FMIN,
+   LIVE_OCTAVE_CORRECTION,
+   LIVE_OUTLIER_FILTER,
+   LIVE_THRESHOLD,
+   SCRIPT_PROCESSOR_BUFFER,
+   WORKLET_HOP_SIZE,
+} from "../frontend/live-pipeline.js";
+import { encodeWav } from "../frontend/pcm-capture.js";
+import { PitchDetector } from "../pitch-detector.js";
+import { replay } from "./replay.js";
+import { PcmFile, readWav } from "./wav.js";
+
+const DATA_DIR = path.join(path.dirname(fileURLToPath(import.meta.url)), "data");
+const RECORDING = path.join(DATA_DIR, "e.wav");
+
+test("Replays produce identical traces", () => {
+   const file = new PcmFile(RECORDING);
+   try {
+      for (const pipeline of ["worklet", "script-processor"] as const) {
+         const first = replay(file, { path: pipeline });
+         const second = replay(file, { path: pipeline });
+         assert.deepStrictEqual(second.trace, first.trace, `${pipeline}: traces differ`);
+         assert.ok(first.summary.detections > 0, `${pipeline}: no detections`);
+         assert.ok(first.summary.rendered > 0 && first.summary.rendered <= first.summary.detections);
+         // A detection waits at most one display frame
+         assert.ok(first.summary.p99LatencyMs <= 1000 / 60 + 1e-6, `${pipeline}: ${first.summary.p99LatencyMs}ms`);
+      }
+   } finally {
+      file.close();
+   }
+});
+
+test("Script processor replay matches the detector on whole buffers", () => {
+   const { samples, sampleRate } = readWav(RECORDING);
+   const detector = new PitchDetector({
+      sampleRate,
+      threshold: LIVE_THRESHOLD,
+      fMin: LIVE_FMIN,
+      outlierFilter: LIVE_OUTLIER_FILTER,
+      octaveCorrection: LIVE_OCTAVE_CORRECTION,
+   });
+   const expected: number[] = [];
+   for (let offset = 0; offset + SCRIPT_PROCESSOR_BUFFER <= samples.length; offset += SCRIPT_PROCESSOR_BUFFER) {
+      const result = detector.processAudioChunk(samples.subarray(offset, offset + SCRIPT_PROCESSOR_BUFFER));
+      expected.push(result ? result.frequency : Number.NaN);
+   }
+
+   const file = new PcmFile(RECORDING);
+   try {
+      const { trace } = replay(file, { path: "script-processor" });
+      assert.deepStrictEqual(
+         trace.map((row) => row.frequency),
+         expected,
+      );
+   } finally {
+      file.close();
+   }
+});
+
+test("Start frame lines a capture's hops up with the full session", () => {
+   const { samples, sampleRate } = readWav(RECORDING);
+   // Captures start on a render quantum, which need not be a hop boundary once the ring wrapped
+   const startFrame = WORKLET_HOP_SIZE * 40 + 256;
+   const captureDir = fs.mkdtempSync(path.join(os.tmpdir(), "tuner-replay-"));
+   const capturePath = path.join(captureDir, "capture.wav");
+   fs.writeFileSync(capturePath, new Uint8Array(encodeWav(samples.subarray(startFrame), sampleRate)));
+
+   const full = new PcmFile(RECORDING);
+   const capture = new PcmFile(capturePath);
+   try {
+      const offsetMs = (startFrame / sampleRate) * 1000;
+      const session = new Map(replay(full).trace.map((row) => [row.timeMs.toFixed(3), row.frequency]));
+      // Skip the analyses whose window or smoothing history still reaches back before the capture
+      const replayed = replay(capture, { startFrame }).trace.slice(16);
+      assert.ok(replayed.length > 100);
+      for (const row of replayed) {
+         const time = (row.timeMs + offsetMs).toFixed(3);
+         assert.ok(session.has(time), `No session analysis at ${time}ms`);
+         assert.strictEqual(row.frequency, session.get(time), `Analysis at ${time}ms differs`);
+      }
+   } finally {
+      full.close();
+      capture.close();
+      fs.rmSync(captureDir, { recursive: true });
+   }
+});
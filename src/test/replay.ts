@@ -0,0 +1,196 @@
+import {
+   LIVE_FMIN,
+   LIVE_OCTAVE_CORRECTION,
+   LIVE_OUTLIER_FILTER,
+   LIVE_THRESHOLD,
+   RENDER_QUANTUM,
+   SCRIPT_PROCESSOR_BUFFER,
+   WORKLET_ENGINE,
+   WORKLET_HOP_SIZE,
+} from "../frontend/live-pipeline.js";
+import { needleAngle, TunerDisplay } from "../frontend/tuner-display.js";
+import type { OutlierStrategy } from "../outlier-filter.js";
+import { PitchDetector } from "../pitch-detector.js";
+import type { PcmFile } from "./wav.js";
+
+// Deterministic replay of a recording through the live tuner's pipeline: the audio path's
+// chunking and detector, the latest-value slot rendered once per display frame, the display
+// logic with its lastValidCents fallback and the needle spring. All times are on the audio
+// clock of the recording, so a replay runs as fast as the detector allows and produces the
+// same trace on every machine.
+
+export type ReplayPath = "worklet" | "script-processor";
+
+export interface ReplayOptions {
+   path?: ReplayPath; // Detection path of the browser (default: "worklet")
+   refreshRate?: number; // Display frames per second (default: 60)
+   a4Frequency?: number; // A4 reference (default: 440)
+   outlierFilter?: OutlierStrategy; // (default: the live tuner's)
+   octaveCorrection?: boolean; // (default: the live tuner's)
+   // Index of the recording's first sample in the live input, e.g. the startFrame of a capture.
+   // Lines the worklet's hops up with the live session's.
+   startFrame?: number;
+}
+
+// One row per analysis, detected or not
+export interface TraceRow {
+   chunk: number;
+   timeMs: number; // Audio time at the end of the analysed window
+   detected: boolean;
+   frequency: number; // Smoothed frequency, NaN without a detection
+   note: string;
+   cents: number;
+   rendered: boolean; // False if a newer detection replaced this one before the next frame
+   latencyMs: number; // End of the analysed window to the frame rendering it, NaN if not rendered
+   // Display state at the last frame before the next analysis
+   lastValidCents: number; // Where the needle is heading
+   targetAngle: number;
+   needleAngle: number;
+}
+
+export interface ReplaySummary {
+   analyses: number;
+   detections: number;
+   rendered: number;
+   frames: number;
+   audioSeconds: number;
+   p50LatencyMs: number;
+   p99LatencyMs: number;
+   // Mean distance of the needle from the angle of lastValidCents over all frames, how far the
+   // needle trails the detections
+   meanNeedleLagDegrees: number;
+   wallMs: number; // Only field that differs between runs
+   realtimeFactor: number;
+}
+
+function percentile(sorted: number[], p: number): number {
+   return sorted.length > 0 ? sorted[Math.min(sorted.length - 1, Math.floor((p / 100) * sorted.length))] : 0;
+}
+
+export function replay(file: PcmFile, options: ReplayOptions = {}): { trace: TraceRow[]; summary: ReplaySummary } {
+   const path = options.path ?? "worklet";
+   const sampleRate = file.format.sampleRate;
+   const frameMs = 1000 / (options.refreshRate ?? 60);
+   const settings = {
+      sampleRate,
+      threshold: LIVE_THRESHOLD,
+      fMin: LIVE_FMIN,
+      a4Frequency: options.a4Frequency ?? 440,
+      outlierFilter: options.outlierFilter ?? LIVE_OUTLIER_FILTER,
+      octaveCorrection: options.octaveCorrection ?? LIVE_OCTAVE_CORRECTION,
+   };
+   const detector =
+      path === "worklet"
+         ? new PitchDetector({ ...settings, hopSize: WORKLET_HOP_SIZE, ...WORKLET_ENGINE })
+         : new PitchDetector({ ...settings, reuseResult: true });
+   const blockSize = path === "worklet" ? RENDER_QUANTUM : SCRIPT_PROCESSOR_BUFFER;
+
+   const display = new TunerDisplay();
+   const trace: TraceRow[] = [];
+   const latencies: number[] = [];
+   let latest: TraceRow | null = null; // The latest-detection slot of GuitarTuner
+   let nextFrame = 0;
+   let frames = 0;
+   let needleLag = 0;
+
+   // Renders the display frames up to time, like GuitarTuner.renderFrame
+   const renderFrames = (time: number) => {
+      for (; nextFrame <= time; nextFrame += frameMs) {
+         if (latest) {
+            display.detection(latest.note, latest.frequency, latest.cents, latest.timeMs);
+            latest.rendered = true;
+            latest.latencyMs = nextFrame - latest.timeMs;
+            latencies.push(latest.latencyMs);
+            latest = null;
+         }
+         const angle = display.frame(nextFrame);
+         const targetAngle = needleAngle(display.lastValidCents);
+         needleLag += Math.abs(targetAngle - angle);
+         frames++;
+         const row = trace[trace.length - 1];
+         if (row) {
+            row.lastValidCents = display.lastValidCents;
+            row.targetAngle = targetAngle;
+            row.needleAngle = angle;
+         }
+      }
+   };
+
+   const start = performance.now();
+   // The worklet's hops started at the first sample of the live input
+   if (path === "worklet") {
+      detector.pushSamples(new Float32Array((options.startFrame ?? 0) % WORKLET_HOP_SIZE));
+   }
+
+   const block = new Float32Array(blockSize);
+   const blocks = Math.floor(file.frames / blockSize);
+   for (let index = 0; index < blocks; index++) {
+      const timeMs = (((index + 1) * blockSize) / sampleRate) * 1000;
+      // Frames up to the end of this block still show the previous detections
+      renderFrames(timeMs - 1e-6);
+
+      file.read(index * blockSize, block);
+      const analyses = detector.analyses;
+      const result = path === "worklet" ? detector.pushSamples(block) : detector.processAudioChunk(block);
+      if (detector.analyses === analyses) continue;
+
+      const previous = trace[trace.length - 1];
+      const row: TraceRow = {
+         chunk: trace.length,
+         timeMs,
+         detected: result !== null,
+         frequency: result ? result.frequency : Number.NaN,
+         note: result ? result.note : "",
+         cents: result ? result.cents : Number.NaN,
+         rendered: false,
+         latencyMs: Number.NaN,
+         lastValidCents: display.lastValidCents,
+         targetAngle: previous ? previous.targetAngle : 0,
+         needleAngle: previous ? previous.needleAngle : 0,
+      };
+      trace.push(row);
+      // Only detections are published, a newer one overwrites an unrendered one
+      if (result) latest = row;
+   }
+   renderFrames((blocks * blockSize * 1000) / sampleRate);
+   const wallMs = performance.now() - start;
+
+   latencies.sort((a, b) => a - b);
+   const audioSeconds = (blocks * blockSize) / sampleRate;
+   return {
+      trace,
+      summary: {
+         analyses: trace.length,
+         detections: trace.filter((row) => row.detected).length,
+         rendered: latencies.length,
+         frames,
+         audioSeconds,
+         p50LatencyMs: percentile(latencies, 50),
+         p99LatencyMs: percentile(latencies, 99),
+         meanNeedleLagDegrees: frames > 0 ? needleLag / frames : 0,
+         wallMs,
+         realtimeFactor: audioSeconds / (wallMs / 1000),
+      },
+   };
+}
+
+const CSV_COLUMNS: Array<keyof TraceRow> = [
+   "chunk",
+   "timeMs",
+   "detected",
+   "frequency",
+   "note",
+   "cents",
+   "rendered",
+   "latencyMs",
+   "lastValidCents",
+   "targetAngle",
+   "needleAngle",
+];
+
+export function traceToCsv(trace: TraceRow[]): string {
+   const format = (value: unknown) =>
+      typeof value === "number" ? (Number.isNaN(value) ? "" : String(Number(value.toFixed(4)))) : String(value);
+   const rows = trace.map((row) => CSV_COLUMNS.map((column) => format(row[column])).join(","));
+   return `${[CSV_COLUMNS.join(","), ...rows].join("\n")}\n`;
+}
@@ -1,7 +1,8 @@
 import fs from "node:fs";
-import wav from "wav";
 import ExcelJS from "exceljs";
 import { PitchDetector } from "../pitch-detector.js";
+import { CHUNK_SIZE } from "./batch.js";
+import { PcmFile, streamWav, type WavFormat } from "./wav.js";
 
 interface DetectionResult {
    timestamp: number;
@@ -16,80 +17,67 @@ interface DetectionResult {
 interface AnalysisConfig {
    enableDebug: boolean;
    smoothingAnalysis: boolean;
+   searchRange: boolean; // Restrict the period search to a fifth around the expected string
+   raw: boolean; // Read chunks with pread instead of streaming the file
 }
 
-function readWavFile(filePath: string): Promise<{ audioData: Float32Array; sampleRate: number }> {
-   return new Promise((resolve, reject) => {
-      const reader = new wav.Reader();
-      const chunks: Buffer[] = [];
-      let wavSampleRate = 44100; // Default fallback
-
-      reader.on("format", (format) => {
-         console.log(`WAV format: ${format.channels} channels, ${format.sampleRate}Hz, ${format.bitDepth}-bit`);
-         wavSampleRate = format.sampleRate;
-      });
-
-      reader.on("data", (chunk) => {
-         chunks.push(chunk);
-      });
-
-      reader.on("end", () => {
-         const buffer = Buffer.concat(chunks);
-
-         // Handle 16-bit PCM (most common format)
-         const samples = new Float32Array(buffer.length / 2);
-         for (let i = 0; i < samples.length; i++) {
-            // Convert 16-bit signed integer to float (-1.0 to 1.0)
-            const int16 = buffer.readInt16LE(i * 2);
-            samples[i] = int16 / 32768.0;
-         }
-
-         resolve({ audioData: samples, sampleRate: wavSampleRate });
-      });
-
-      reader.on("error", reject);
+// Chunks of the file, the last one possibly shorter. The chunk array is reused.
+async function* readChunks(
+   filePath: string,
+   raw: boolean,
+): AsyncGenerator<{ format: WavFormat; samples: Float32Array }> {
+   if (!raw) {
+      yield* streamWav(filePath, CHUNK_SIZE);
+      return;
+   }
 
-      fs.createReadStream(filePath).pipe(reader);
-   });
+   // Only the header is parsed up front, each chunk is read from its offset in the data chunk
+   const file = new PcmFile(filePath);
+   try {
+      const chunk = new Float32Array(CHUNK_SIZE);
+      for (let start = 0; start < file.frames; start += CHUNK_SIZE) {
+         yield { format: file.format, samples: chunk.subarray(0, file.read(start, chunk)) };
+      }
+   } finally {
+      file.close();
+   }
 }
 
 async function analyzeWavFile(filePath: string, config: AnalysisConfig) {
    try {
-      const { audioData, sampleRate } = await readWavFile(filePath);
-
-      // Create YIN detector with correct sample rate from WAV file
-      const detector = new PitchDetector({
-         sampleRate: sampleRate,
-         debug: config.enableDebug,
-         threshold: 0.1,
-         fMin: 40.0,
-      });
-
-      const chunkSize = detector.chunkSize;
-      const numChunks = Math.floor(audioData.length / chunkSize);
+      let detector: PitchDetector | null = null;
+      let numChunks = 0;
+      let totalSamples = 0;
       const results: DetectionResult[] = [];
 
-      for (let i = 0; i < numChunks; i++) {
-         const chunkStart = i * chunkSize;
-         const chunk = audioData.slice(chunkStart, chunkStart + chunkSize);
+      // The file is decoded chunk by chunk while it is read, memory stays constant for any length
+      for await (const { format, samples: chunk } of readChunks(filePath, config.raw)) {
+         totalSamples += chunk.length;
+         if (!detector) {
+            console.log(`WAV format: ${format.channels} channels, ${format.sampleRate}Hz, ${format.bitDepth}-bit`);
+            detector = createDetector(filePath, format.sampleRate, config);
+         }
+         // A trailing partial chunk is not analysed
+         if (chunk.length < CHUNK_SIZE) break;
 
+         const i = numChunks++;
+         const chunkStart = i * CHUNK_SIZE;
          const result = detector.processAudioChunk(chunk);
          const timestamp = (chunkStart / detector.sampleRate) * 1000; // ms
 
          if (result) {
-            // Calculate RMS amplitude for this chunk
-            const rms = Math.sqrt(chunk.reduce((sum, sample) => sum + sample * sample, 0) / chunk.length);
-            
             results.push({
                timestamp,
                chunkIndex: i,
                frequency: result.frequency,
                note: result.note,
                cents: result.cents,
-               amplitude: rms,
+               confidence: result.confidence,
+               amplitude: result.windowRms,
             });
          }
       }
+      if (!detector) throw new Error(`${filePath}: no audio data`);
 
       // Filter out pluck transients
       const filteredResults = filterPluckTransients(results);
@@ -119,7 +107,7 @@ async function analyzeWavFile(filePath: string, config: AnalysisConfig) {
          console.log(`  Average frequency: ${avgFreq.toFixed(1)}Hz`);
          console.log(`  Dominant note: ${dominantNote}`);
          console.log(
-            `  Detection rate: ${(results.length / (audioData.length / detector.sampleRate)).toFixed(1)} detections/second`,
+            `  Detection rate: ${(results.length / (totalSamples / detector.sampleRate)).toFixed(1)} detections/second`,
          );
       } else {
          console.log("No pitch detected in any chunk");
@@ -130,6 +118,27 @@ async function analyzeWavFile(filePath: string, config: AnalysisConfig) {
    }
 }
 
+function createDetector(filePath: string, sampleRate: number, config: AnalysisConfig): PitchDetector {
+   // Create YIN detector with correct sample rate from WAV file
+   const detector = new PitchDetector({
+      sampleRate: sampleRate,
+      debug: config.enableDebug,
+      threshold: 0.1,
+      fMin: 40.0,
+      earlyExit: true,
+   });
+
+   if (config.searchRange) {
+      const expected = getExpectedFrequency(filePath);
+      const fifth = 2 ** (7 / 12);
+      const tauLo = sampleRate / (expected.frequency * fifth);
+      const tauHi = sampleRate / (expected.frequency / fifth);
+      detector.setTauRange(tauLo, tauHi);
+      console.log(`Search range: ${expected.note} ± a fifth, tau ${tauLo.toFixed(0)}-${tauHi.toFixed(0)}`);
+   }
+   return detector;
+}
+
 function getExpectedFrequency(filePath: string): { note: string; frequency: number } {
    const filename = filePath.toLowerCase();
 
@@ -311,6 +320,8 @@ async function createHtmlReport(results: DetectionResult[], wavFilePath: string,
                     <th>Note</th>
                     <th>Cents</th>
                     <th>Deviation from ${expectedNote}</th>
+                    <th>Confidence</th>
+                    <th>RMS</th>
                 </tr>
             </thead>
             <tbody>
@@ -326,6 +337,8 @@ async function createHtmlReport(results: DetectionResult[], wavFilePath: string,
                             <td>${r.note}</td>
                             <td>${r.cents?.toFixed(1) || ""}</td>
                             <td>${deviation > 0 ? "+" : ""}${deviation.toFixed(1)}Hz</td>
+                            <td>${r.confidence?.toFixed(3) ?? ""}</td>
+                            <td>${r.amplitude?.toFixed(4) ?? ""}</td>
                         </tr>
                     `;
                    })
@@ -494,9 +507,11 @@ function analyzeResults(results: DetectionResult[], numChunks: number, totalSamp
 const args = process.argv.slice(2);
 
 if (args.length === 0) {
-   console.log("Usage: node test-wav-file.ts <wav-file-path> [--debug]");
+   console.log("Usage: node test-wav-file.ts <wav-file-path> [--debug] [--search-range] [--raw]");
    console.log("Examples:");
    console.log("  node test-wav-file.ts e.wav --debug  # HTML with debug logging");
+   console.log("  node test-wav-file.ts e.wav --search-range  # Only search periods near the expected string");
+   console.log("  node test-wav-file.ts take.wav --raw  # Read chunks with pread, for very large files");
    process.exit(1);
 }
 
@@ -506,6 +521,8 @@ const enableDebug = args.includes("--debug");
 const config: AnalysisConfig = {
    enableDebug,
    smoothingAnalysis: true,
+   searchRange: args.includes("--search-range"),
+   raw: args.includes("--raw"),
 };
 
 if (!fs.existsSync(wavFilePath)) {
@@ -0,0 +1,144 @@
+import assert from "node:assert";
+import fs from "node:fs";
+import os from "node:os";
+import path from "node:path";
+import { test } from "node:test";
+import { PcmFile, readWav, streamWav, WavDecoder } from "./wav.js";
+
+interface Encoding {
+   format: number;
+   bitDepth: number;
+   channels: number;
+   extensible?: boolean;
+}
+
+// Builds a WAV file with an odd-sized chunk before and a chunk after the data
+function encodeWav(frames: number[][], { format, bitDepth, channels, extensible }: Encoding): Buffer {
+   const sampleBytes = bitDepth / 8;
+   const data = Buffer.alloc(frames.length * channels * sampleBytes);
+   let pos = 0;
+   for (const frame of frames) {
+      for (const sample of frame) {
+         if (format === 3 && bitDepth === 32) data.writeFloatLE(sample, pos);
+         else if (format === 3) data.writeDoubleLE(sample, pos);
+         else if (bitDepth === 8) data.writeUInt8(Math.round(sample * 127) + 128, pos);
+         else data.writeIntLE(Math.round(sample * (2 ** (bitDepth - 1) - 1)), pos, Math.min(sampleBytes, 6));
+         pos += sampleBytes;
+      }
+   }
+
+   const fmt = Buffer.alloc(extensible ? 40 : 16);
+   fmt.writeUInt16LE(extensible ? 0xfffe : format, 0);
+   fmt.writeUInt16LE(channels, 2);
+   fmt.writeUInt32LE(48000, 4);
+   fmt.writeUInt32LE(48000 * channels * sampleBytes, 8);
+   fmt.writeUInt16LE(channels * sampleBytes, 12);
+   fmt.writeUInt16LE(bitDepth, 14);
+   if (extensible) {
+      fmt.writeUInt16LE(22, 16);
+      fmt.writeUInt16LE(format, 24);
+   }
+
+   const chunk = (id: string, body: Buffer) => {
+      const header = Buffer.alloc(8);
+      header.write(id, 0, "ascii");
+      header.writeUInt32LE(body.length, 4);
+      return Buffer.concat([header, body, Buffer.alloc(body.length & 1)]);
+   };
+   const body = Buffer.concat([
+      Buffer.from("WAVE", "ascii"),
+      chunk("fmt ", fmt),
+      chunk("LIST", Buffer.from("INFOabc", "ascii")),
+      chunk("data", data),
+      chunk("id3 ", Buffer.alloc(10, 0x55)),
+   ]);
+   const riff = Buffer.alloc(8);
+   riff.write("RIFF", 0, "ascii");
+   riff.writeUInt32LE(body.length, 4);
+   return Buffer.concat([riff, body]);
+}
+
+const encodings: Encoding[] = [
+   { format: 1, bitDepth: 8, channels: 1 },
+   { format: 1, bitDepth: 16, channels: 1 },
+   { format: 1, bitDepth: 16, channels: 2 },
+   { format: 1, bitDepth: 24, channels: 2 },
+   { format: 1, bitDepth: 24, channels: 6, extensible: true },
+   { format: 1, bitDepth: 32, channels: 1 },
+   { format: 3, bitDepth: 32, channels: 2 },
+   { format: 3, bitDepth: 64, channels: 1, extensible: true },
+];
+
+for (const encoding of encodings) {
+   const { format, bitDepth, channels, extensible } = encoding;
+   const name = `${format === 3 ? "float" : "PCM"} ${bitDepth}-bit, ${channels} channels${extensible ? ", extensible" : ""}`;
+
+   test(`WAV decoding: ${name}`, async () => {
+      const frames = Array.from({ length: 1001 }, (_, i) =>
+         Array.from({ length: channels }, (_, c) => 0.9 * Math.sin(0.01 * i * (c + 1))),
+      );
+      const expected = frames.map((frame) => frame.reduce((sum, sample) => sum + sample, 0) / channels);
+      const tolerance = Math.max(2 / 2 ** (bitDepth - 1), 1e-6);
+      const file = encodeWav(frames, encoding);
+
+      const check = (samples: ArrayLike<number>, what: string) => {
+         assert.strictEqual(samples.length, expected.length, `${what}: length`);
+         for (let i = 0; i < expected.length; i++) {
+            assert.ok(Math.abs(samples[i] - expected[i]) <= tolerance, `${what}[${i}]: ${samples[i]} != ${expected[i]}`);
+         }
+      };
+
+      // Byte by byte, the worst case for headers and frames split across writes
+      const decoder = new WavDecoder();
+      const samples = new Float32Array(frames.length);
+      let filled = 0;
+      for (let i = 0; i < file.length; i++) {
+         decoder.write(file.subarray(i, i + 1));
+         filled += decoder.read(samples, filled);
+      }
+      decoder.end();
+      assert.deepStrictEqual(decoder.format, { format, channels, sampleRate: 48000, bitDepth });
+      check(samples.subarray(0, filled), "byte by byte");
+
+      const dir = fs.mkdtempSync(path.join(os.tmpdir(), "tuner-wav-"));
+      try {
+         const filePath = path.join(dir, "test.wav");
+         fs.writeFileSync(filePath, file);
+         check(readWav(filePath).samples, "readWav");
+
+         const streamed: number[] = [];
+         for await (const block of streamWav(filePath, 64)) streamed.push(...block.samples);
+         check(streamed, "streamWav");
+
+         const pcm = new PcmFile(filePath);
+         try {
+            assert.deepStrictEqual(pcm.format, decoder.format);
+            const all = new Float32Array(pcm.frames);
+            pcm.read(0, all);
+            check(all, "PcmFile");
+
+            // Reads past the end are cut short
+            const tail = new Float32Array(100);
+            assert.strictEqual(pcm.read(950, tail), 51);
+            check([...all.subarray(0, 950), ...tail.subarray(0, 51)], "PcmFile tail");
+         } finally {
+            pcm.close();
+         }
+      } finally {
+         fs.rmSync(dir, { recursive: true, force: true });
+      }
+   });
+}
+
+test("WAV decoding rejects unsupported input", () => {
+   const decoder = new WavDecoder("bad.wav");
+   assert.throws(() => decoder.write(Buffer.from("RIFX\0\0\0\0WAVE")), /bad.wav: not a RIFF\/WAVE file/);
+
+   const adpcm = encodeWav([[0]], { format: 1, bitDepth: 16, channels: 1 });
+   adpcm.writeUInt16LE(2, 20);
+   assert.throws(() => new WavDecoder().write(adpcm), /unsupported format 2/);
+
+   const truncated = new WavDecoder();
+   truncated.write(adpcm.subarray(0, 30));
+   assert.throws(() => truncated.end(), /truncated header/);
+});
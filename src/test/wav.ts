@@ -0,0 +1,312 @@
+import fs from "node:fs";
+
+// RIFF/WAVE decoding for tests and tools. Integer PCM (8/16/24/32-bit) and IEEE float (32/64-bit)
+// samples, plain or WAVE_FORMAT_EXTENSIBLE, with all channels averaged to mono float samples.
+
+export interface WavFormat {
+   format: number; // 1 = integer PCM, 3 = IEEE float
+   channels: number;
+   sampleRate: number;
+   bitDepth: number;
+}
+
+const FORMAT_PCM = 1;
+const FORMAT_FLOAT = 3;
+const FORMAT_EXTENSIBLE = 0xfffe;
+
+type SampleReader = (bytes: Uint8Array, view: DataView, pos: number) => number;
+
+function sampleReader(format: number, bitDepth: number): SampleReader | null {
+   if (format === FORMAT_PCM) {
+      switch (bitDepth) {
+         case 8:
+            return (bytes, _view, pos) => (bytes[pos] - 128) / 128;
+         case 16:
+            return (_bytes, view, pos) => view.getInt16(pos, true) / 32768;
+         case 24:
+            return (bytes, _view, pos) =>
+               (((bytes[pos] | (bytes[pos + 1] << 8) | (bytes[pos + 2] << 16)) << 8) >> 8) / 8388608;
+         case 32:
+            return (_bytes, view, pos) => view.getInt32(pos, true) / 2147483648;
+      }
+   } else if (format === FORMAT_FLOAT) {
+      if (bitDepth === 32) return (_bytes, view, pos) => view.getFloat32(pos, true);
+      if (bitDepth === 64) return (_bytes, view, pos) => view.getFloat64(pos, true);
+   }
+   return null;
+}
+
+// Converts frames starting at byte pos to mono floats in out[start, start + frames), returns the byte
+// position after the last frame
+function convertFrames(
+   format: WavFormat,
+   readSample: SampleReader,
+   bytes: Uint8Array,
+   view: DataView,
+   pos: number,
+   out: Float32Array,
+   start: number,
+   frames: number,
+): number {
+   const { channels } = format;
+   const sampleBytes = format.bitDepth / 8;
+   for (let i = 0; i < frames; i++) {
+      let sum = 0;
+      for (let c = 0; c < channels; c++, pos += sampleBytes) sum += readSample(bytes, view, pos);
+      out[start + i] = sum / channels;
+   }
+   return pos;
+}
+
+const EMPTY = new Uint8Array(0);
+
+// Incremental decoder: input arrives in arbitrary pieces through write(), read() converts the
+// complete frames received so far. Only a partial frame or chunk header is carried over between
+// writes, so memory does not grow with the length of the recording.
+export class WavDecoder {
+   format: WavFormat | null = null;
+
+   private bytes: Uint8Array = EMPTY;
+   private written = 0;
+   private view = new DataView(EMPTY.buffer);
+   private offset = 0;
+   private riff = false;
+   private skip = 0; // bytes of an ignored chunk still to drop
+   private dataRemaining = -1; // bytes left in the data chunk, -1 until it starts
+   private frameBytes = 0;
+   private readSample: SampleReader | null = null;
+   private readonly source: string;
+
+   constructor(source = "WAV") {
+      this.source = source; // Prefix of error messages
+   }
+
+   write(data: Uint8Array) {
+      // Anything after the data chunk is ignored
+      if (this.ready && this.dataRemaining < this.frameBytes) return;
+      const rest = this.bytes.length - this.offset;
+      if (rest > 0) {
+         const joined = new Uint8Array(rest + data.length);
+         joined.set(this.bytes.subarray(this.offset));
+         joined.set(data, rest);
+         data = joined;
+      }
+      this.written += data.length - rest;
+      this.bytes = data;
+      this.view = new DataView(data.buffer, data.byteOffset, data.byteLength);
+      this.offset = 0;
+      this.parseHeader();
+   }
+
+   // True once the header is parsed, samples can be read from here on
+   get ready(): boolean {
+      return this.dataRemaining >= 0;
+   }
+
+   // File offset of the next byte to decode, the start of the samples once ready
+   get position(): number {
+      return this.written - (this.bytes.length - this.offset);
+   }
+
+   // Bytes of the data chunk not decoded yet, -1 before the header is parsed
+   get remainingBytes(): number {
+      return this.dataRemaining;
+   }
+
+   // Complete frames that read() can deliver without further input
+   get bufferedFrames(): number {
+      if (!this.ready) return 0;
+      return Math.floor(Math.min(this.bytes.length - this.offset, this.dataRemaining) / this.frameBytes);
+   }
+
+   // Converts up to out.length - start buffered frames into out, returns the number converted
+   read(out: Float32Array, start = 0): number {
+      const frames = Math.min(this.bufferedFrames, out.length - start);
+      if (frames <= 0) return 0;
+      const { bytes, view } = this;
+      this.offset = convertFrames(this.format!, this.readSample!, bytes, view, this.offset, out, start, frames);
+      this.dataRemaining -= frames * this.frameBytes;
+      return frames;
+   }
+
+   // Throws unless the data chunk has been reached
+   end() {
+      if (!this.ready) {
+         throw new Error(`${this.source}: ${this.format ? "no data chunk" : "truncated header"}`);
+      }
+   }
+
+   private parseHeader() {
+      while (!this.ready) {
+         const available = this.bytes.length - this.offset;
+         if (this.skip > 0) {
+            const skipped = Math.min(this.skip, available);
+            this.offset += skipped;
+            this.skip -= skipped;
+            if (this.skip > 0) return;
+            continue;
+         }
+
+         if (!this.riff) {
+            if (available < 12) return;
+            const { bytes, offset } = this;
+            if (ascii(bytes, offset) !== "RIFF" || ascii(bytes, offset + 8) !== "WAVE") {
+               throw new Error(`${this.source}: not a RIFF/WAVE file`);
+            }
+            this.riff = true;
+            this.offset += 12;
+            continue;
+         }
+
+         if (available < 8) return;
+         const id = ascii(this.bytes, this.offset);
+         const size = this.view.getUint32(this.offset + 4, true);
+         if (id === "data") {
+            if (!this.format) throw new Error(`${this.source}: data chunk before fmt chunk`);
+            this.offset += 8;
+            // Recorders that were not stopped cleanly leave the size at 0, read to the end then
+            this.dataRemaining = size === 0 ? Number.POSITIVE_INFINITY : size;
+         } else if (id === "fmt ") {
+            if (available < 8 + size) return;
+            this.parseFormat(this.offset + 8, size);
+            // Chunks are padded to an even size
+            this.offset += 8 + size;
+            this.skip = size & 1;
+         } else {
+            this.offset += 8;
+            this.skip = size + (size & 1);
+         }
+      }
+   }
+
+   private parseFormat(body: number, size: number) {
+      const view = this.view;
+      let format = view.getUint16(body, true);
+      const channels = view.getUint16(body + 2, true);
+      const sampleRate = view.getUint32(body + 4, true);
+      const bitDepth = view.getUint16(body + 14, true);
+      // The extensible format carries the actual format code in the first two bytes of its subformat GUID
+      if (format === FORMAT_EXTENSIBLE && size >= 40) format = view.getUint16(body + 24, true);
+
+      this.readSample = sampleReader(format, bitDepth);
+      if (!this.readSample || channels === 0) {
+         throw new Error(`${this.source}: unsupported format ${format}, ${bitDepth}-bit, ${channels} channels`);
+      }
+      this.format = { format, channels, sampleRate, bitDepth };
+      this.frameBytes = channels * (bitDepth / 8);
+   }
+}
+
+function ascii(bytes: Uint8Array, offset: number): string {
+   return String.fromCharCode(bytes[offset], bytes[offset + 1], bytes[offset + 2], bytes[offset + 3]);
+}
+
+// Streams a WAV file as mono blocks of blockFrames samples, the last one possibly shorter.
+// The block is reused: consume it before advancing the iterator.
+export async function* streamWav(
+   filePath: string,
+   blockFrames = 4096,
+): AsyncGenerator<{ format: WavFormat; samples: Float32Array }> {
+   const decoder = new WavDecoder(filePath);
+   const block = new Float32Array(blockFrames);
+   let filled = 0;
+   for await (const data of fs.createReadStream(filePath)) {
+      decoder.write(data as Buffer);
+      while (decoder.bufferedFrames > 0) {
+         filled += decoder.read(block, filled);
+         if (filled === blockFrames) {
+            yield { format: decoder.format!, samples: block };
+            filled = 0;
+         }
+      }
+   }
+   decoder.end();
+   if (filled > 0) yield { format: decoder.format!, samples: block.subarray(0, filled) };
+}
+
+// Reads a whole WAV file into memory
+export function readWav(filePath: string): { samples: Float32Array; sampleRate: number } {
+   const decoder = new WavDecoder(filePath);
+   decoder.write(fs.readFileSync(filePath));
+   decoder.end();
+   const samples = new Float32Array(decoder.bufferedFrames);
+   decoder.read(samples);
+   return { samples, sampleRate: decoder.format!.sampleRate };
+}
+
+// Random access to the samples of a WAV file through positional reads (pread), the nearest Node
+// gets to mapping the file. Only the header is parsed up front and read() fetches just the
+// requested frames, so neither startup time nor memory grow with the file size. Mono 32-bit float
+// data is read straight into the caller's array.
+export class PcmFile {
+   readonly format: WavFormat;
+   readonly frames: number;
+
+   private readonly fd: number;
+   private readonly dataOffset: number;
+   private readonly frameBytes: number;
+   private readonly readSample: SampleReader;
+   private readonly direct: boolean;
+   private scratch = EMPTY;
+   private view = new DataView(EMPTY.buffer);
+
+   constructor(filePath: string) {
+      this.fd = fs.openSync(filePath, "r");
+      try {
+         const decoder = new WavDecoder(filePath);
+         for (let position = 0; !decoder.ready; ) {
+            // The decoder may keep a reference to the last piece, so each read gets a fresh buffer
+            const header = new Uint8Array(4096);
+            const bytesRead = fs.readSync(this.fd, header, 0, header.length, position);
+            if (bytesRead === 0) break;
+            decoder.write(header.subarray(0, bytesRead));
+            position += bytesRead;
+         }
+         decoder.end();
+
+         const format = decoder.format!;
+         this.format = format;
+         this.dataOffset = decoder.position;
+         this.frameBytes = format.channels * (format.bitDepth / 8);
+         this.readSample = sampleReader(format.format, format.bitDepth)!;
+         this.direct = format.format === FORMAT_FLOAT && format.bitDepth === 32 && format.channels === 1;
+         const fileBytes = fs.fstatSync(this.fd).size - this.dataOffset;
+         this.frames = Math.floor(Math.min(decoder.remainingBytes, fileBytes) / this.frameBytes);
+      } catch (error) {
+         fs.closeSync(this.fd);
+         throw error;
+      }
+   }
+
+   // Reads frames [start, start + out.length) as mono samples into out, returns the number read
+   read(start: number, out: Float32Array): number {
+      const frames = Math.max(0, Math.min(out.length, this.frames - start));
+      const bytes = frames * this.frameBytes;
+      const position = this.dataOffset + start * this.frameBytes;
+      if (this.direct) {
+         // WAV is little endian, like every platform this runs on
+         this.readFully(out, bytes, position);
+         return frames;
+      }
+
+      if (this.scratch.length < bytes) {
+         this.scratch = new Uint8Array(bytes);
+         this.view = new DataView(this.scratch.buffer);
+      }
+      this.readFully(this.scratch, bytes, position);
+      convertFrames(this.format, this.readSample, this.scratch, this.view, 0, out, 0, frames);
+      return frames;
+   }
+
+   close() {
+      fs.closeSync(this.fd);
+   }
+
+   private readFully(target: ArrayBufferView, bytes: number, position: number) {
+      for (let done = 0; done < bytes; ) {
+         const bytesRead = fs.readSync(this.fd, target, done, bytes - done, position + done);
+         if (bytesRead === 0) throw new Error("Unexpected end of file");
+         done += bytesRead;
+      }
+   }
+}
@@ -0,0 +1,244 @@
+// WebAssembly SIMD kernel for the YIN difference function and CMNDF.
+// The module is assembled here from a few opcodes instead of shipping a separate .wasm build,
+// it is a few hundred bytes and compiles synchronously, also inside an AudioWorklet.
+
+// Opcodes used by the kernel, see the WebAssembly core and fixed-width SIMD specs
+const BLOCK = 0x02;
+const LOOP = 0x03;
+const END = 0x0b;
+const BR = 0x0c;
+const BR_IF = 0x0d;
+const LOCAL_GET = 0x20;
+const LOCAL_SET = 0x21;
+const LOCAL_TEE = 0x22;
+const F32_LOAD = 0x2a;
+const F32_STORE = 0x38;
+const I32_CONST = 0x41;
+const F64_CONST = 0x44;
+const I32_GT_S = 0x4a;
+const I32_GE_S = 0x4e;
+const I32_ADD = 0x6a;
+const I32_SUB = 0x6b;
+const I32_SHL = 0x74;
+const F32_SUB = 0x93;
+const F32_MUL = 0x94;
+const F64_ADD = 0xa0;
+const F64_MUL = 0xa2;
+const F64_DIV = 0xa3;
+const F32_DEMOTE_F64 = 0xb6;
+const F64_CONVERT_I32_S = 0xb7;
+const F64_PROMOTE_F32 = 0xbb;
+const SIMD = 0xfd;
+const V128_LOAD = 0x00;
+const V128_CONST = 0x0c;
+const I8X16_SHUFFLE = 0x0d;
+const F64X2_EXTRACT_LANE = 0x21;
+const F64X2_PROMOTE_LOW_F32X4 = 0x5f;
+const F32X4_SUB = 229;
+const F32X4_MUL = 230;
+const F64X2_ADD = 240;
+
+const VOID = 0x40;
+const I32 = 0x7f;
+const F32 = 0x7d;
+const F64 = 0x7c;
+const V128 = 0x7b;
+
+function leb128(value: number): number[] {
+   const bytes: number[] = [];
+   do {
+      let byte = value & 0x7f;
+      value >>>= 7;
+      if (value !== 0) byte |= 0x80;
+      bytes.push(byte);
+   } while (value !== 0);
+   return bytes;
+}
+
+function name(text: string): number[] {
+   const bytes = Array.from(text, (c) => c.charCodeAt(0));
+   return [...leb128(bytes.length), ...bytes];
+}
+
+function vector(items: number[][]): number[] {
+   return [...leb128(items.length), ...items.flat()];
+}
+
+function section(id: number, items: number[][]): number[] {
+   const content = vector(items);
+   return [id, ...leb128(content.length), ...content];
+}
+
+function simd(op: number): number[] {
+   return [SIMD, ...leb128(op)];
+}
+
+function get(index: number): number[] {
+   return [LOCAL_GET, index];
+}
+
+function set(index: number): number[] {
+   return [LOCAL_SET, index];
+}
+
+// address = base + index * 4
+function address(base: number, index: number): number[] {
+   return [...get(base), ...get(index), I32_CONST, 2, I32_SHL, I32_ADD];
+}
+
+// difference(frame, n, start, diff, maxTau): for 1 <= tau < maxTau,
+// diff[tau] = sum over start <= i < n - tau of (frame[i] - frame[i + tau])^2.
+// Four lanes are subtracted and squared in f32, partial sums are accumulated in f64 like the JS loop.
+function differenceBody(): number[] {
+   const [frame, n, start, diff, maxTau] = [0, 1, 2, 3, 4];
+   const [tau, i, end, a, lo, hi, sq, sum, d] = [5, 6, 7, 8, 9, 10, 11, 12, 13];
+   const zero = [...simd(V128_CONST), ...new Array(16).fill(0)];
+   const highHalf = [8, 9, 10, 11, 12, 13, 14, 15, 8, 9, 10, 11, 12, 13, 14, 15];
+   const tauBytes = [...get(tau), I32_CONST, 2, I32_SHL];
+   const code = [
+      ...[I32_CONST, 1, ...set(tau)],
+      ...[BLOCK, VOID, LOOP, VOID],
+      ...[...get(tau), ...get(maxTau), I32_GE_S, BR_IF, 1],
+      ...[...get(n), ...get(tau), I32_SUB, ...set(end)],
+      ...[...get(start), ...set(i)],
+      ...[...zero, ...set(lo), ...zero, ...set(hi)],
+      // Vector loop, four pairs per iteration
+      ...[BLOCK, VOID, LOOP, VOID],
+      ...[...get(i), I32_CONST, 4, I32_ADD, ...get(end), I32_GT_S, BR_IF, 1],
+      ...[...address(frame, i), ...set(a)],
+      ...[...get(a), ...simd(V128_LOAD), 0, 0],
+      ...[...get(a), ...tauBytes, I32_ADD, ...simd(V128_LOAD), 0, 0],
+      ...[...simd(F32X4_SUB), LOCAL_TEE, sq, ...get(sq), ...simd(F32X4_MUL), ...set(sq)],
+      ...[...get(lo), ...get(sq), ...simd(F64X2_PROMOTE_LOW_F32X4), ...simd(F64X2_ADD), ...set(lo)],
+      ...[...get(hi), ...get(sq), ...get(sq), ...simd(I8X16_SHUFFLE), ...highHalf],
+      ...[...simd(F64X2_PROMOTE_LOW_F32X4), ...simd(F64X2_ADD), ...set(hi)],
+      ...[...get(i), I32_CONST, 4, I32_ADD, ...set(i), BR, 0],
+      ...[END, END],
+      // Horizontal sum of the four f64 lanes
+      ...[...get(lo), ...simd(F64X2_EXTRACT_LANE), 0, ...get(lo), ...simd(F64X2_EXTRACT_LANE), 1, F64_ADD],
+      ...[...get(hi), ...simd(F64X2_EXTRACT_LANE), 0, F64_ADD, ...get(hi), ...simd(F64X2_EXTRACT_LANE), 1, F64_ADD],
+      ...set(sum),
+      // Scalar tail
+      ...[BLOCK, VOID, LOOP, VOID],
+      ...[...get(i), ...get(end), I32_GE_S, BR_IF, 1],
+      ...[...address(frame, i), LOCAL_TEE, a, F32_LOAD, 2, 0],
+      ...[...get(a), ...tauBytes, I32_ADD, F32_LOAD, 2, 0, F32_SUB],
+      ...[LOCAL_TEE, d, ...get(d), F32_MUL, F64_PROMOTE_F32, ...get(sum), F64_ADD, ...set(sum)],
+      ...[...get(i), I32_CONST, 1, I32_ADD, ...set(i), BR, 0],
+      ...[END, END],
+      ...[...address(diff, tau), ...get(sum), F32_DEMOTE_F64, F32_STORE, 2, 0],
+      ...[...get(tau), I32_CONST, 1, I32_ADD, ...set(tau), BR, 0],
+      ...[END, END, END],
+   ];
+   const locals = vector([
+      [4, I32],
+      [3, V128],
+      [1, F64],
+      [1, F32],
+   ]);
+   return [...leb128(locals.length + code.length), ...locals, ...code];
+}
+
+// cmndf(diff, cmndf, maxTau): cmndf[0] = 1, cmndf[tau] = diff[tau] * tau / sum(diff[1..tau]).
+// A prefix sum does not vectorise, but keeping it next to the difference stage avoids a JS pass.
+function cmndfBody(): number[] {
+   const [diff, cmndf, maxTau] = [0, 1, 2];
+   const [tau, sum, d] = [3, 4, 5];
+   const one = [F64_CONST, 0, 0, 0, 0, 0, 0, 0xf0, 0x3f];
+   const code = [
+      ...[...get(cmndf), ...one, F32_DEMOTE_F64, F32_STORE, 2, 0],
+      ...[I32_CONST, 1, ...set(tau)],
+      ...[BLOCK, VOID, LOOP, VOID],
+      ...[...get(tau), ...get(maxTau), I32_GE_S, BR_IF, 1],
+      ...[...address(diff, tau), F32_LOAD, 2, 0, F64_PROMOTE_F32, LOCAL_TEE, d],
+      ...[...get(sum), F64_ADD, ...set(sum)],
+      ...[...address(cmndf, tau), ...get(d), ...get(tau), F64_CONVERT_I32_S, F64_MUL, ...get(sum), F64_DIV],
+      ...[F32_DEMOTE_F64, F32_STORE, 2, 0],
+      ...[...get(tau), I32_CONST, 1, I32_ADD, ...set(tau), BR, 0],
+      ...[END, END, END],
+   ];
+   const locals = vector([
+      [1, I32],
+      [2, F64],
+   ]);
+   return [...leb128(locals.length + code.length), ...locals, ...code];
+}
+
+function assemble(): Uint8Array {
+   const differenceType = [0x60, ...vector([[I32], [I32], [I32], [I32], [I32]]), 0];
+   const cmndfType = [0x60, ...vector([[I32], [I32], [I32]]), 0];
+   return new Uint8Array([
+      ...[0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00],
+      ...section(1, [differenceType, cmndfType]),
+      ...section(2, [[...name("env"), ...name("memory"), 0x02, 0x00, ...leb128(1)]]),
+      ...section(3, [[0], [1]]),
+      ...section(7, [
+         [...name("difference"), 0x00, 0],
+         [...name("cmndf"), 0x00, 1],
+      ]),
+      ...section(10, [differenceBody(), cmndfBody()]),
+   ]);
+}
+
+let compiled: WebAssembly.Module | null | undefined;
+
+// Compiled once per global scope, null if WebAssembly or SIMD is unavailable
+function compile(): WebAssembly.Module | null {
+   if (compiled !== undefined) return compiled;
+   compiled = null;
+   if (typeof WebAssembly === "undefined") return compiled;
+   const bytes = assemble();
+   if (WebAssembly.validate(bytes)) {
+      compiled = new WebAssembly.Module(bytes);
+   }
+   return compiled;
+}
+
+const PAGE_SIZE = 65536;
+
+type DifferenceFunction = (frame: number, n: number, start: number, diff: number, maxTau: number) => void;
+type CmndfFunction = (diff: number, cmndf: number, maxTau: number) => void;
+
+// Frame, difference function and CMNDF live in the kernel's linear memory. diff and cmndf are
+// views onto it, so the rest of YIN reads the kernel output without copying.
+export class WasmYinKernel {
+   readonly diff: Float32Array;
+   readonly cmndf: Float32Array;
+
+   private input: Float32Array;
+   private differenceFn: DifferenceFunction;
+   private cmndfFn: CmndfFunction;
+
+   static isSupported(): boolean {
+      return compile() !== null;
+   }
+
+   constructor(frameSize: number, maxTau: number) {
+      const module = compile();
+      if (!module) {
+         throw new Error("WebAssembly SIMD is not supported");
+      }
+
+      const bytes = (frameSize + 2 * maxTau) * Float32Array.BYTES_PER_ELEMENT;
+      const memory = new WebAssembly.Memory({ initial: Math.max(1, Math.ceil(bytes / PAGE_SIZE)) });
+      const instance = new WebAssembly.Instance(module, { env: { memory } });
+      this.differenceFn = instance.exports.difference as DifferenceFunction;
+      this.cmndfFn = instance.exports.cmndf as CmndfFunction;
+
+      // The memory never grows, so the views stay attached
+      this.input = new Float32Array(memory.buffer, 0, frameSize);
+      this.diff = new Float32Array(memory.buffer, this.input.byteOffset + this.input.byteLength, maxTau);
+      this.cmndf = new Float32Array(memory.buffer, this.diff.byteOffset + this.diff.byteLength, maxTau);
+   }
+
+   // Difference function of frame[start, frame.length) into diff[1, maxTau)
+   difference(frame: Float32Array, start: number, maxTau: number): void {
+      this.input.set(frame);
+      this.differenceFn(this.input.byteOffset, frame.length, start, this.diff.byteOffset, maxTau);
+   }
+
+   // CMNDF of diff into cmndf[0, maxTau)
+   cumulativeMeanNormalized(maxTau: number): void {
+      this.cmndfFn(this.diff.byteOffset, this.cmndf.byteOffset, maxTau);
+   }
+}